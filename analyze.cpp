@@ -0,0 +1,523 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs the checkers of the plugin on the translation units listed in
+// a compile_commands.json file, without a build.  The translation
+// units are parsed in syntax-only mode by several threads in one
+// process.  The threads share a cache of stat results and one
+// database connection.
+//
+// Translation units are scheduled by their analysis time in previous
+// runs (the tu_costs table), largest first.  Each thread has its own
+// queue, and idle threads steal from the queues of the others.
+
+#include "checkers.hpp"
+
+#include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Frontend/FrontendAction.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Threading.h"
+
+#include <algorithm>
+#include <deque>
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////
+// Shared stat cache
+
+// Results of stat calls, shared by the FileManagers of all threads.
+// Header search probes the same non-existing paths for every
+// translation unit, so negative results are cached as well.  Only
+// absolute paths are cached, because relative paths depend on the
+// working directory of the translation unit.
+class SharedStatCache {
+  struct Entry {
+    bool Exists;
+    struct stat Stat;
+  };
+  llvm::StringMap<Entry> Entries;
+  pthread_mutex_t Lock;
+
+public:
+  class Client;
+  friend class Client;
+
+  SharedStatCache()
+  {
+    pthread_mutex_init(&Lock, NULL);
+  }
+
+  ~SharedStatCache()
+  {
+    pthread_mutex_destroy(&Lock);
+  }
+
+  // Adapter for one FileManager, which takes ownership of it.
+  class Client : public FileSystemStatCache {
+    SharedStatCache &Shared;
+
+  public:
+    Client(SharedStatCache &S)
+      : Shared(S)
+    {
+    }
+
+    virtual LookupResult getStat(const char *Path, struct stat &StatBuf,
+				 bool isFile, int *FileDescriptor)
+    {
+      if (Path[0] != '/') {
+	return statChained(Path, StatBuf, isFile, FileDescriptor);
+      }
+      {
+	MutexGuard Guard(&Shared.Lock);
+	llvm::StringMap<Entry>::const_iterator p = Shared.Entries.find(Path);
+	if (p != Shared.Entries.end()) {
+	  if (!p->second.Exists) {
+	    return CacheMissing;
+	  }
+	  StatBuf = p->second.Stat;
+	  return CacheExists;
+	}
+      }
+      // If a file descriptor is returned, FileManager uses it to read
+      // the file.  Otherwise, it opens the file itself.
+      LookupResult Result = statChained(Path, StatBuf, isFile, FileDescriptor);
+      Entry E;
+      E.Exists = Result == CacheExists;
+      E.Stat = StatBuf;
+      MutexGuard Guard(&Shared.Lock);
+      Shared.Entries[Path] = E;
+      return Result;
+    }
+  };
+
+private:
+  SharedStatCache(const SharedStatCache &); // not implemented
+  SharedStatCache &operator=(const SharedStatCache &); // not implemented
+};
+
+//////////////////////////////////////////////////////////////////////
+// Translation units
+
+struct Task {
+  tooling::CompileCommand Command;
+  std::string File;
+  double Cost;			// seconds, negative if unknown
+  double Elapsed;		// seconds, negative if failed
+
+  // Translation units without a known cost are scheduled first,
+  // because they may be arbitrarily large.
+  bool operator<(const Task &Other) const
+  {
+    if ((Cost < 0) != (Other.Cost < 0)) {
+      return Cost < 0;
+    }
+    return Cost > Other.Cost;
+  }
+};
+
+class AnalyzeAction : public ASTFrontendAction {
+  std::tr1::shared_ptr<FileIdentificationDatabase> FileDB;
+  std::tr1::shared_ptr<const CheckerOptions> Options;
+  pthread_mutex_t *CommitLock;
+
+public:
+  AnalyzeAction(std::tr1::shared_ptr<FileIdentificationDatabase> DB,
+		std::tr1::shared_ptr<const CheckerOptions> options,
+		pthread_mutex_t *commitLock)
+    : FileDB(DB), Options(options), CommitLock(commitLock)
+  {
+  }
+
+protected:
+  ASTConsumer *CreateASTConsumer(CompilerInstance &, llvm::StringRef) {
+    return new ConsumerFromVisitor<CheckerVisitor<AllCheckers> >
+      (FileDB, Options, 1, CommitLock);
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Scheduler
+
+class Scheduler {
+  std::tr1::shared_ptr<Database> DB;
+  std::tr1::shared_ptr<const CheckerOptions> Options;
+  SharedStatCache StatCache;
+  pthread_mutex_t CommitLock;
+  bool Verbose;
+
+  std::vector<Task> &Tasks;
+
+  // One queue of indexes into Tasks per thread.  The owner takes
+  // tasks from the front (the largest), thieves from the back.
+  struct Queue {
+    std::deque<size_t> Tasks;
+    pthread_mutex_t Lock;
+  };
+  std::vector<Queue> Queues;
+
+  struct Worker {
+    Scheduler *Owner;
+    size_t Index;
+  };
+
+public:
+  Scheduler(std::tr1::shared_ptr<Database> db,
+	    std::tr1::shared_ptr<const CheckerOptions> options,
+	    bool verbose, std::vector<Task> &tasks, unsigned Jobs)
+    : DB(db), Options(options), Verbose(verbose), Tasks(tasks),
+      Queues(Jobs)
+  {
+    pthread_mutex_init(&CommitLock, NULL);
+    // Tasks is sorted, so dealing it out gives each queue a similar
+    // share of the expensive translation units.
+    for (size_t i = 0; i < Tasks.size(); ++i) {
+      Queues[i % Jobs].Tasks.push_back(i);
+    }
+    for (size_t i = 0; i < Queues.size(); ++i) {
+      pthread_mutex_init(&Queues[i].Lock, NULL);
+    }
+  }
+
+  ~Scheduler()
+  {
+    for (size_t i = 0; i < Queues.size(); ++i) {
+      pthread_mutex_destroy(&Queues[i].Lock);
+    }
+    pthread_mutex_destroy(&CommitLock);
+  }
+
+  // Processes all tasks.  Returns the number of failed translation
+  // units.
+  unsigned Run()
+  {
+    std::vector<Worker> Workers(Queues.size());
+    std::vector<pthread_t> Threads;
+    for (size_t i = 0; i < Workers.size(); ++i) {
+      Workers[i].Owner = this;
+      Workers[i].Index = i;
+    }
+    for (size_t i = 1; i < Workers.size(); ++i) {
+      pthread_t Thread;
+      if (pthread_create(&Thread, NULL, RunWorker, &Workers[i]) != 0) {
+	// The queue is emptied by the other threads.
+	continue;
+      }
+      Threads.push_back(Thread);
+    }
+    RunWorker(&Workers[0]);
+    for (std::vector<pthread_t>::iterator p = Threads.begin(),
+	   end = Threads.end(); p != end; ++p) {
+      pthread_join(*p, NULL);
+    }
+
+    unsigned Failed = 0;
+    for (std::vector<Task>::const_iterator p = Tasks.begin(),
+	   end = Tasks.end(); p != end; ++p) {
+      if (p->Elapsed < 0) {
+	++Failed;
+      }
+    }
+    return Failed;
+  }
+
+private:
+  Scheduler(const Scheduler &);	// not implemented
+  Scheduler &operator=(const Scheduler &); // not implemented
+
+  static void *RunWorker(void *Closure)
+  {
+    Worker &W(*static_cast<Worker *>(Closure));
+    size_t Index;
+    while (W.Owner->NextTask(W.Index, Index)) {
+      W.Owner->Analyze(W.Owner->Tasks[Index]);
+    }
+    return NULL;
+  }
+
+  // Obtains the next task for the thread, from its own queue or by
+  // stealing.  No tasks are added after the start, so the thread can
+  // exit once all queues are empty.
+  bool NextTask(size_t Self, size_t &Index)
+  {
+    {
+      Queue &Own(Queues[Self]);
+      MutexGuard Guard(&Own.Lock);
+      if (!Own.Tasks.empty()) {
+	Index = Own.Tasks.front();
+	Own.Tasks.pop_front();
+	return true;
+      }
+    }
+    for (size_t i = 1; i < Queues.size(); ++i) {
+      Queue &Victim(Queues[(Self + i) % Queues.size()]);
+      MutexGuard Guard(&Victim.Lock);
+      if (!Victim.Tasks.empty()) {
+	Index = Victim.Tasks.back();
+	Victim.Tasks.pop_back();
+	return true;
+      }
+    }
+    return false;
+  }
+
+  void Analyze(Task &T)
+  {
+    double Start = Now();
+    if (Verbose) {
+      fprintf(stderr, "analyzing %s\n", T.File.c_str());
+    }
+
+    // Relative paths are resolved against the directory of the
+    // compile command, without changing the directory of the
+    // process.
+    FileSystemOptions FSOptions;
+    FSOptions.WorkingDir = T.Command.Directory;
+    FileManager Files(FSOptions);
+    Files.addStatCache(new SharedStatCache::Client(StatCache));
+
+    std::tr1::shared_ptr<FileIdentificationDatabase> FileDB
+      (new FileIdentificationDatabase(DB));
+    FileDB->SetDirectory(T.Command.Directory);
+
+    std::vector<std::string> CommandLine(T.Command.CommandLine);
+    CommandLine.push_back("-fsyntax-only");
+    tooling::ToolInvocation Invocation
+      (CommandLine, new AnalyzeAction(FileDB, Options, &CommitLock), &Files);
+    if (Invocation.run()) {
+      T.Elapsed = Now() - Start;
+    } else {
+      fprintf(stderr, "%s: error: analysis failed\n", T.File.c_str());
+      T.Elapsed = -1;
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Cost history
+
+// Returns the canonical path of File, which is relative to the
+// directory of Command unless it is absolute.
+std::string
+TaskFile(const tooling::CompileCommand &Command, const std::string &File)
+{
+  std::string Path(File);
+  if (!File.empty() && File[0] != '/' && !Command.Directory.empty()) {
+    Path = Command.Directory;
+    if (Path[Path.size() - 1] != '/') {
+      Path += '/';
+    }
+    Path += File;
+  }
+  std::string Resolved;
+  if (ResolvePath(Path.c_str(), Resolved)) {
+    return Resolved;
+  }
+  return Path;
+}
+
+bool
+LoadCosts(Database &DB, std::vector<Task> &Tasks)
+{
+  Statement Select;
+  if (!Select.Prepare(DB, "SELECT seconds FROM tu_costs WHERE path = ?")) {
+    return false;
+  }
+  for (std::vector<Task>::iterator p = Tasks.begin(), end = Tasks.end();
+       p != end; ++p) {
+    sqlite3_reset(Select.Ptr);
+    sqlite3_bind_text(Select.Ptr, 1, p->File.data(), p->File.size(),
+		      SQLITE_TRANSIENT);
+    int ret = sqlite3_step(Select.Ptr);
+    if (ret == SQLITE_ROW) {
+      p->Cost = sqlite3_column_double(Select.Ptr, 0);
+    } else if (ret != SQLITE_DONE) {
+      DB.SetError(sqlite3_sql(Select.Ptr));
+      return false;
+    }
+  }
+  return true;
+}
+
+TransactionResult::Enum
+StoreCosts(Database &DB, const std::vector<Task> &Tasks)
+{
+  Statement Insert;
+  TransactionResult::Enum tret = Insert.TxnPrepare
+    (DB, "INSERT OR REPLACE INTO tu_costs (path, seconds) VALUES (?, ?)");
+  if (tret != TransactionResult::COMMIT) {
+    return tret;
+  }
+  for (std::vector<Task>::const_iterator p = Tasks.begin(),
+	 end = Tasks.end(); p != end; ++p) {
+    if (p->Elapsed < 0) {
+      continue;
+    }
+    sqlite3_reset(Insert.Ptr);
+    sqlite3_bind_text(Insert.Ptr, 1, p->File.data(), p->File.size(),
+		      SQLITE_TRANSIENT);
+    sqlite3_bind_double(Insert.Ptr, 2, p->Elapsed);
+    if (sqlite3_step(Insert.Ptr) != SQLITE_DONE) {
+      return DB.SetTransactionError(sqlite3_sql(Insert.Ptr));
+    }
+  }
+  return TransactionResult::COMMIT;
+}
+
+void
+Usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [-v] [-j JOBS] [-p BUILD-DIRECTORY] "
+	  "[-e PREFIX]... [-a TOOL]... [FILE...]\n", progname);
+}
+
+const struct option LongOptions[] = {
+  {"verbose", no_argument, NULL, 'v'},
+  {"jobs", required_argument, NULL, 'j'},
+  {"build-path", required_argument, NULL, 'p'},
+  {"exclude", required_argument, NULL, 'e'},
+  {"aggregate", required_argument, NULL, 'a'},
+  {NULL, 0, NULL, 0}
+};
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+  bool verbose = false;
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *buildPath = ".";
+  std::tr1::shared_ptr<CheckerOptions> options(new CheckerOptions);
+  int opt;
+  while ((opt = getopt_long(argc, argv, "vj:p:e:a:",
+			    LongOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'v':
+      verbose = true;
+      break;
+    case 'j':
+      {
+	char *end;
+	errno = 0;
+	jobs = strtol(optarg, &end, 10);
+	if (errno != 0 || *end != '\0' || end == optarg
+	    || jobs <= 0 || jobs > 1024) {
+	  fprintf(stderr, "error: invalid number of jobs: %s\n", optarg);
+	  return 1;
+	}
+      }
+      break;
+    case 'p':
+      buildPath = optarg;
+      break;
+    case 'e':
+      {
+	std::string prefix;
+	if (!ResolvePath(optarg, prefix)) {
+	  prefix = optarg;
+	}
+	options->Excluded.Add(prefix);
+      }
+      break;
+    case 'a':
+      options->Aggregated.insert(optarg);
+      break;
+    default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (jobs <= 0) {
+    jobs = 1;
+  }
+
+  std::tr1::shared_ptr<Database> DB(new Database);
+  if (!DB->Open()) {
+    fprintf(stderr, "error: could not open database: %s\n",
+	    DB->ErrorMessage.c_str());
+    return 1;
+  }
+
+  std::string errorMessage;
+  llvm::OwningPtr<tooling::CompilationDatabase> compilations
+    (tooling::CompilationDatabase::loadFromDirectory(buildPath, errorMessage));
+  if (!compilations) {
+    fprintf(stderr, "error: %s\n", errorMessage.c_str());
+    return 1;
+  }
+
+  std::vector<std::string> files;
+  if (optind < argc) {
+    files.assign(argv + optind, argv + argc);
+  } else {
+    files = compilations->getAllFiles();
+  }
+
+  std::vector<Task> tasks;
+  for (std::vector<std::string>::const_iterator p = files.begin(),
+	 end = files.end(); p != end; ++p) {
+    std::vector<tooling::CompileCommand> commands
+      (compilations->getCompileCommands(*p));
+    if (commands.empty()) {
+      fprintf(stderr, "%s: error: no compile command found\n", p->c_str());
+      return 1;
+    }
+    for (std::vector<tooling::CompileCommand>::const_iterator
+	   q = commands.begin(), qend = commands.end(); q != qend; ++q) {
+      Task t;
+      t.Command = *q;
+      t.File = TaskFile(*q, *p);
+      t.Cost = -1;
+      t.Elapsed = -1;
+      tasks.push_back(t);
+    }
+  }
+  if (!LoadCosts(*DB, tasks)) {
+    fprintf(stderr, "error: %s\n", DB->ErrorMessage.c_str());
+    return 1;
+  }
+  std::stable_sort(tasks.begin(), tasks.end());
+
+  llvm::llvm_start_multithreaded();
+  unsigned failed;
+  {
+    Scheduler scheduler(DB, options, verbose, tasks, jobs);
+    failed = scheduler.Run();
+  }
+
+  if (DB->Transact(std::tr1::bind(StoreCosts, std::tr1::ref(*DB),
+				  std::tr1::cref(tasks)))
+      != TransactionResult::COMMIT) {
+    fprintf(stderr, "error: %s\n", DB->ErrorMessage.c_str());
+    return 1;
+  }
+  if (failed > 0) {
+    fprintf(stderr, "error: %u of %zu translation units failed\n",
+	    failed, tasks.size());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Counts heap allocations in a process.  Load with LD_PRELOAD.  On
+ * exit, the number of calls to malloc, calloc, realloc and
+ * memalign-style functions is appended to the file named by the
+ * ALLOC_COUNT_FILE environment variable (or written to standard
+ * error if it is not set).  C++ operator new is counted because it
+ * calls malloc.
+ *
+ * Compiled with -DALLOC_COUNT_LINKED, the file can be linked into a
+ * program instead, which reads the counter with alloc_count().
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void *__libc_memalign(size_t, size_t);
+
+static unsigned long long count;
+
+unsigned long long
+alloc_count(void)
+{
+  return __atomic_load_n(&count, __ATOMIC_RELAXED);
+}
+
+void *
+malloc(size_t size)
+{
+  __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+  __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+  return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+  __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+
+void *
+memalign(size_t alignment, size_t size)
+{
+  __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+  return __libc_memalign(alignment, size);
+}
+
+int
+posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+  void *p = memalign(alignment, size);
+  if (p == NULL) {
+    return 12; /* ENOMEM */
+  }
+  *ptr = p;
+  return 0;
+}
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+  return memalign(alignment, size);
+}
+
+#ifndef ALLOC_COUNT_LINKED
+static void __attribute__((destructor))
+report(void)
+{
+  unsigned long long total = __atomic_load_n(&count, __ATOMIC_RELAXED);
+  const char *path = getenv("ALLOC_COUNT_FILE");
+  FILE *out = NULL;
+  if (path != NULL && *path != '\0') {
+    out = fopen(path, "a");
+  }
+  if (out != NULL) {
+    fprintf(out, "%llu\n", total);
+    fclose(out);
+  } else {
+    fprintf(stderr, "alloc-count: %llu\n", total);
+  }
+}
+#endif
@@ -0,0 +1,117 @@
+#!/bin/bash
+# End-to-end benchmark: builds a synthetic corpus (see gen-corpus.sh)
+# with plain clang++ and with the cxx wrapper, at several -j levels.
+#
+# For each level, one line is appended to RESULTS/e2e.tsv with these
+# tab-separated fields:
+#
+#   date, jobs, translation units, plain build seconds, plugin build
+#   seconds, plugin overhead per TU in milliseconds, commit latency
+#   percentiles (50, 90, 99) in milliseconds, transaction retries,
+#   database size in bytes, report wall time in seconds
+#
+# The per-TU statistics written by the plugin are kept in
+# RESULTS/stats-jN.tsv.
+#
+# Usage: bench/e2e.sh [-n TUS] [-f FUNCTIONS] [-d HEADER-DEPTH]
+#                     [-j "JOBS..."] [-o RESULTS]
+
+set -e
+
+bench=$(cd "$(dirname "$0")" && pwd)
+top=$(dirname "$bench")
+tus=200
+functions=20
+depth=10
+levels="1 4 16"
+results="$PWD/bench-results"
+
+while getopts "n:f:d:j:o:" opt ; do
+    case "$opt" in
+	n) tus="$OPTARG" ;;
+	f) functions="$OPTARG" ;;
+	d) depth="$OPTARG" ;;
+	j) levels="$OPTARG" ;;
+	o) results="$OPTARG" ;;
+	*) echo "usage: $0 [-n TUS] [-f FUNCTIONS] [-d HEADER-DEPTH]" \
+	       "[-j \"JOBS...\"] [-o RESULTS]" 1>&2
+	   exit 1 ;;
+    esac
+done
+
+for f in "$top/plugin.so" "$top/create-db" "$top/report" ; do
+    if ! test -e "$f" ; then
+	echo "error: $f not found (run \"make bench-e2e\")" 1>&2
+	exit 1
+    fi
+done
+
+mkdir -p "$results"
+results=$(cd "$results" && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+"$bench/gen-corpus.sh" "$work" "$tus" "$functions" "$depth"
+cd "$work"
+
+now () {
+    date +%s%N
+}
+
+seconds () {
+    awk -v ns="$1" 'BEGIN { printf "%.3f", ns / 1e9 }'
+}
+
+# Prints the given percentiles of the numbers on standard input, in
+# milliseconds.
+percentiles () {
+    sort -n | awk -v p="$*" '
+	{ v[NR] = $1 }
+	END {
+	    n = split(p, ps, " ")
+	    for (i = 1; i <= n; ++i) {
+		k = int((NR - 1) * ps[i] / 100) + 1
+		printf "%s%.3f", (i > 1 ? "\t" : ""), (NR ? v[k] * 1000 : 0)
+	    }
+	}'
+}
+
+if ! test -e "$results/e2e.tsv" ; then
+    printf "date\tjobs\ttus\tplain_s\tplugin_s\toverhead_ms_per_tu\t" \
+	> "$results/e2e.tsv"
+    printf "commit_p50_ms\tcommit_p90_ms\tcommit_p99_ms\tretries\t" \
+	>> "$results/e2e.tsv"
+    printf "db_bytes\treport_s\n" >> "$results/e2e.tsv"
+fi
+
+for jobs in $levels ; do
+    make -s clean
+    start=$(now)
+    make -s -j"$jobs" CXX=clang++
+    plain=$(( $(now) - start ))
+
+    make -s clean
+    rm -f htcondor-analyzer.sqlite*
+    "$top/create-db"
+    stats="$results/stats-j$jobs.tsv"
+    rm -f "$stats"
+    start=$(now)
+    HTCONDOR_ANALYSIS_STATS="$stats" make -s -j"$jobs" CXX="$top/cxx"
+    plugin=$(( $(now) - start ))
+
+    start=$(now)
+    "$top/report" > /dev/null
+    report=$(( $(now) - start ))
+
+    overhead=$(awk -v a="$plugin" -v b="$plain" -v n="$tus" \
+	'BEGIN { printf "%.3f", (a - b) / n / 1e6 }')
+    commit=$(cut -f 3 "$stats" | percentiles 50 90 99)
+    retries=$(awk -F '\t' '{ s += $4 } END { print s + 0 }' "$stats")
+    # Includes the write-ahead log.
+    size=$(cat htcondor-analyzer.sqlite* | wc -c)
+
+    printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" \
+	"$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$jobs" "$tus" \
+	"$(seconds $plain)" "$(seconds $plugin)" "$overhead" \
+	"$commit" "$retries" "$size" "$(seconds $report)" \
+	| tee -a "$results/e2e.tsv"
+done
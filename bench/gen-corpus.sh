@@ -0,0 +1,133 @@
+#!/bin/bash
+# Generates a synthetic C++ source tree resembling HTCondor, for the
+# end-to-end benchmark.  The translation units use MyString,
+# Register_Command, sprintf, strcpy, pointer arithmetic and standard
+# containers, and include a chain of project headers.
+#
+# Usage: bench/gen-corpus.sh DIRECTORY [TUS] [FUNCTIONS] [HEADER-DEPTH]
+#
+# The directory receives a Makefile which builds all translation
+# units with $(CXX).
+
+set -e
+
+if test $# -lt 1 ; then
+    echo "usage: $0 DIRECTORY [TUS] [FUNCTIONS] [HEADER-DEPTH]" 1>&2
+    exit 1
+fi
+out="$1"
+tus="${2:-100}"
+functions="${3:-20}"
+depth="${4:-10}"
+
+mkdir -p "$out/include" "$out/src"
+
+cat > "$out/include/condor_common.h" <<EOF
+#pragma once
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+class MyString {
+public:
+  MyString();
+  MyString(const char *);
+  const char *Value() const;
+  char operator[](int) const;
+  MyString &operator+=(const char *);
+  int sprintf(const char *, ...);
+private:
+  char *Data;
+  int Length;
+};
+
+int sprintf(MyString &, const char *, ...);
+int sprintf(std::string &, const char *, ...);
+
+class DaemonCore {
+public:
+  int Register_Command(int command, const char *name, void *handler,
+		       const char *description, void *service = 0,
+		       int perm = 0, int dprintf_flag = 0,
+		       bool force_authentication = false);
+};
+extern DaemonCore *daemonCore;
+EOF
+
+# A chain of headers, each including the next one.
+for ((d = 0; d < depth; ++d)) ; do
+    {
+	echo "#pragma once"
+	if ((d + 1 < depth)) ; then
+	    echo "#include \"condor_layer$((d + 1)).h\""
+	else
+	    echo "#include \"condor_common.h\""
+	fi
+	cat <<EOF
+struct Layer$d {
+  int id;
+  char name[32];
+  MyString label;
+  std::vector<int> values;
+  int get(int i) const { return values[i]; }
+};
+inline int layer${d}_sum(const int *p, int n)
+{
+  int s = 0;
+  for (int i = 0; i < n; ++i) {
+    s += *(p + i);
+  }
+  return s;
+}
+EOF
+    } > "$out/include/condor_layer$d.h"
+done
+
+for ((t = 0; t < tus; ++t)) ; do
+    {
+	echo "#include \"condor_layer0.h\""
+	echo
+	for ((f = 0; f < functions; ++f)) ; do
+	    cat <<EOF
+static int handler_${t}_$f(int, void *) { return 0; }
+
+int tu${t}_f$f(char *buf, const char *src, Layer0 *items, int n)
+{
+  char local[64];
+  MyString ms;
+  std::string s;
+  std::vector<int> v(n);
+  sprintf(local, "%d", n);
+  sprintf(ms, "%s", src);
+  sprintf(s, "%d", n);
+  strcpy(buf, src);
+  memcpy(items, items + 1, sizeof(items));
+  daemonCore->Register_Command($((t * functions + f)), "CMD_$f",
+			       (void *)handler_${t}_$f, "handler", 0, 2);
+  int sum = items[n].id + v[0] + ms[1];
+  sum += layer0_sum(&items->id, n);
+  return sum + local[0];
+}
+
+EOF
+	done
+    } > "$out/src/tu$t.cpp"
+done
+
+cat > "$out/Makefile" <<'EOF'
+CXX ?= clang++
+CXXFLAGS = -O0 -Iinclude
+SOURCES = $(wildcard src/*.cpp)
+OBJECTS = $(SOURCES:.cpp=.o)
+
+all: $(OBJECTS)
+
+%.o: %.cpp
+	$(CXX) $(CXXFLAGS) -c $< -o $@
+
+clean:
+	rm -f $(OBJECTS)
+
+.PHONY: all clean
+EOF
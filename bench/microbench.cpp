@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmarks for the database layer, the report iteration and
+// the text utilities.  Each benchmark prints its throughput and the
+// number of heap allocations per operation (counted by
+// alloc-count.c, which is linked into this program).
+//
+// Usage: microbench [-q] CREATE-DB
+//
+// CREATE-DB is the path to the create-db program.  -q divides the
+// sizes by 100, for a quick check.
+
+#include "db-file.hpp"
+#include "db-report.hpp"
+#include "LineEditor.hpp"
+#include "file.hpp"
+#include "util.hpp"
+
+#include <vector>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+extern "C" unsigned long long alloc_count(void);
+
+static double
+Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Measures the time and allocations from construction to Stop().
+class Measurement {
+  double Start;
+  unsigned long long StartAllocs;
+public:
+  Measurement()
+    : Start(Now()), StartAllocs(alloc_count())
+  {
+  }
+
+  void Stop(const char *Name, unsigned long long Ops)
+  {
+    double Seconds = Now() - Start;
+    unsigned long long Allocs = alloc_count() - StartAllocs;
+    if (Ops == 0) {
+      Ops = 1;
+    }
+    printf("%-40s %10llu ops %10.1f ns/op %12.0f ops/s %8.2f allocs/op\n",
+	   Name, Ops, Seconds * 1e9 / Ops, Ops / Seconds,
+	   double(Allocs) / Ops);
+    fflush(stdout);
+  }
+};
+
+static const unsigned SourceFiles = 100;
+
+static std::string
+SourcePath(unsigned i)
+{
+  std::string Path;
+  FormatString(Path, "src/file%u.c", i);
+  return Path;
+}
+
+static void
+Die(const char *What, const std::string &Message)
+{
+  fprintf(stderr, "error: %s: %s\n", What, Message.c_str());
+  exit(1);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Database
+
+static void
+BenchRecordCommit(std::tr1::shared_ptr<Database> DB, unsigned long long N)
+{
+  std::vector<std::string> Paths;
+  for (unsigned i = 0; i < SourceFiles; ++i) {
+    Paths.push_back(SourcePath(i));
+  }
+  std::string Name;
+
+  FileIdentificationDatabase FileDB(DB);
+  for (unsigned i = 0; i < SourceFiles; ++i) {
+    FileDB.MarkForProcessing(Paths[i].c_str());
+  }
+  {
+    Measurement M;
+    for (unsigned long long i = 0; i < N; ++i) {
+      if (!FileDB.Report(Paths[i % SourceFiles].c_str(),
+			 i / SourceFiles + 1, 1, "bench",
+			 "message", i)) {
+	Die("Record", FileDB.ErrorMessage());
+      }
+    }
+    FormatString(Name, "Record (%llu reports)", N);
+    M.Stop(Name.c_str(), N);
+  }
+  {
+    Measurement M;
+    if (!FileDB.Commit()) {
+      Die("Commit", FileDB.ErrorMessage());
+    }
+    FormatString(Name, "Commit (%llu reports)", N);
+    M.Stop(Name.c_str(), N);
+  }
+}
+
+// Replaces the contents of the database with N reports, spread over
+// the source files, using SQL alone.
+static void
+Populate(Database &DB, unsigned long long N)
+{
+  if (!DB.Execute("DELETE FROM reports; DELETE FROM files;")) {
+    Die("Populate", DB.ErrorMessage);
+  }
+  Statement InsertFile, InsertReports;
+  if (!(InsertFile.Prepare(DB, "INSERT INTO files (id, path, mtime, size) "
+			   "VALUES (?, ?, ?, ?)")
+	&& InsertReports.Prepare
+	(DB, "WITH RECURSIVE n(i) AS "
+	 "(SELECT 0 UNION ALL SELECT i + 1 FROM n WHERE i + 1 < ?1) "
+	 "INSERT INTO reports (file, line, column, tool, message, fingerprint) "
+	 "SELECT 1 + i % ?2, i / ?2 + 1, 1, 'bench', 'message', i FROM n"))) {
+    Die("Populate", DB.ErrorMessage);
+  }
+  for (unsigned i = 0; i < SourceFiles; ++i) {
+    FileIdentification FI(SourcePath(i).c_str());
+    sqlite3_reset(InsertFile.Ptr);
+    sqlite3_bind_int64(InsertFile.Ptr, 1, i + 1);
+    sqlite3_bind_text(InsertFile.Ptr, 2, FI.Path.data(), FI.Path.size(),
+		      SQLITE_TRANSIENT);
+    sqlite3_bind_int64(InsertFile.Ptr, 3, FI.Mtime);
+    sqlite3_bind_int64(InsertFile.Ptr, 4, FI.Size);
+    if (sqlite3_step(InsertFile.Ptr) != SQLITE_DONE) {
+      DB.SetError("Populate");
+      Die("Populate", DB.ErrorMessage);
+    }
+  }
+  sqlite3_bind_int64(InsertReports.Ptr, 1, N);
+  sqlite3_bind_int64(InsertReports.Ptr, 2, SourceFiles);
+  if (sqlite3_step(InsertReports.Ptr) != SQLITE_DONE) {
+    DB.SetError("Populate");
+    Die("Populate", DB.ErrorMessage);
+  }
+}
+
+static bool
+CountReport(unsigned long long &Count, const char *, unsigned, unsigned,
+	    const char *, const char *, unsigned)
+{
+  ++Count;
+  return true;
+}
+
+static void
+BenchReport(Database &DB, unsigned long long N)
+{
+  Populate(DB, N);
+  unsigned long long Count = 0;
+  using namespace std::tr1::placeholders;
+  Measurement M;
+  if (!Report(DB, std::tr1::bind(CountReport, std::tr1::ref(Count),
+				 _1, _2, _3, _4, _5, _6))) {
+    Die("Report", DB.ErrorMessage);
+  }
+  std::string Name;
+  FormatString(Name, "Report (%llu rows)", N);
+  M.Stop(Name.c_str(), Count);
+  if (Count != N) {
+    fprintf(stderr, "error: Report returned %llu of %llu rows\n", Count, N);
+    exit(1);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Text utilities
+
+static void
+BenchLineEditor(unsigned Lines)
+{
+  const char *Path = "large.c";
+  FILE *out = fopen(Path, "w");
+  if (out == NULL) {
+    Die("fopen", ErrorString(errno));
+  }
+  for (unsigned i = 0; i < Lines; ++i) {
+    fprintf(out, "abc  sprintf(buffer, \"%%d\", value%u); /* line %u */\n",
+	    i, i);
+  }
+  fclose(out);
+
+  std::string Name;
+  LineEditor LE;
+  {
+    Measurement M;
+    if (!LE.Read(Path)) {
+      Die("LineEditor::Read", Path);
+    }
+    FormatString(Name, "LineEditor::Read (%u lines)", Lines);
+    M.Stop(Name.c_str(), Lines);
+  }
+  {
+    Measurement M;
+    size_t Total = 0;
+    for (unsigned i = 1; i <= Lines; ++i) {
+      Total += LE.Line(i).size();
+    }
+    FormatString(Name, "LineEditor::Line (%u lines)", Lines);
+    M.Stop(Name.c_str(), Lines);
+    if (Total == 0) {
+      Die("LineEditor::Line", "empty lines");
+    }
+  }
+  {
+    Measurement M;
+    for (unsigned i = 1; i <= Lines; ++i) {
+      if (!LE.Patch(i, 1, "abc", "xyz")) {
+	Die("LineEditor::Patch", "mismatch");
+      }
+    }
+    FormatString(Name, "LineEditor::Patch (%u lines)", Lines);
+    M.Stop(Name.c_str(), Lines);
+  }
+}
+
+static void
+BenchCarets(unsigned long long N)
+{
+  const std::string Text("\tif (sprintf(buffer, \"%d\", value) < 0) {");
+  size_t Total = 0;
+  Measurement M;
+  for (unsigned long long i = 0; i < N; ++i) {
+    Total += Carets(Text, 1 + i % Text.size(), 7).size();
+  }
+  M.Stop("Carets", N);
+  if (Total == 0) {
+    Die("Carets", "empty result");
+  }
+}
+
+static void
+BenchFormat(unsigned long long N)
+{
+  std::string Target;
+  {
+    Measurement M;
+    for (unsigned long long i = 0; i < N; ++i) {
+      FormatString(Target, "%s:%llu:%u: (%s) %s",
+		   "/src/condor_utils/file.cpp", i, 17U, "sprintf", "sprintf");
+    }
+    M.Stop("FormatString", N);
+  }
+  {
+    Measurement M;
+    for (unsigned long long i = 0; i < N; ++i) {
+      if (Target.size() > 4096) {
+	Target.clear();
+      }
+      AppendFormat(Target, " command=%llu", i);
+    }
+    M.Stop("AppendFormat", N);
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  unsigned long long Scale = 1;
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "-q") == 0) {
+    Scale = 100;
+    ++arg;
+  }
+  if (arg + 1 != argc) {
+    fprintf(stderr, "usage: %s [-q] CREATE-DB\n", argv[0]);
+    return 1;
+  }
+  std::string CreateDB;
+  if (!ResolvePath(argv[arg], CreateDB)) {
+    Die(argv[arg], ErrorString(errno));
+  }
+
+  char Template[] = "/tmp/htcondor-microbench-XXXXXX";
+  if (mkdtemp(Template) == NULL || chdir(Template) != 0
+      || system(CreateDB.c_str()) != 0 || mkdir("src", 0777) != 0) {
+    Die("setup", ErrorString(errno));
+  }
+  for (unsigned i = 0; i < SourceFiles; ++i) {
+    FILE *out = fopen(SourcePath(i).c_str(), "w");
+    if (out == NULL) {
+      Die("fopen", ErrorString(errno));
+    }
+    fprintf(out, "int file%u;\n", i);
+    fclose(out);
+  }
+
+  std::tr1::shared_ptr<Database> DB(new Database);
+  if (!DB->Open(Database::FileName)) {
+    Die("open", DB->ErrorMessage);
+  }
+
+  BenchRecordCommit(DB, 1000);
+  BenchRecordCommit(DB, 100000 / Scale);
+  BenchRecordCommit(DB, 1000000 / Scale);
+  BenchReport(*DB, 1000000 / Scale);
+  BenchReport(*DB, 10000000 / Scale);
+  BenchLineEditor(1000000 / Scale);
+  BenchCarets(1000000 / Scale);
+  BenchFormat(1000000 / Scale);
+
+  DB.reset();
+  std::string Cleanup("rm -rf ");
+  Cleanup += Template;
+  return system(Cleanup.c_str()) == 0 ? 0 : 1;
+}
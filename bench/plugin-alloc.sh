@@ -0,0 +1,74 @@
+#!/bin/bash
+# Measures the heap allocations made by the analysis plugin.
+#
+# Generates a translation unit which exercises the checkers, compiles
+# it with -fsyntax-only with and without the plugin under
+# alloc-count.so, and prints the number of additional allocations per
+# 1,000 AST nodes (as counted by -ast-dump).
+#
+# Usage: bench/plugin-alloc.sh [FUNCTIONS]
+
+set -e
+
+bench=$(cd "$(dirname "$0")" && pwd)
+top=$(dirname "$bench")
+plugin="${HTCONDOR_ANALYSIS_PLUGIN:-$top/plugin.so}"
+preload="$bench/alloc-count.so"
+functions="${1:-2000}"
+
+for f in "$plugin" "$preload" "$top/create-db" ; do
+    if ! test -e "$f" ; then
+	echo "error: $f not found (run \"make bench-plugin-alloc\")" 1>&2
+	exit 1
+    fi
+done
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+"$top/create-db"
+
+{
+    cat <<EOF
+typedef __SIZE_TYPE__ size_t;
+extern "C" void *memcpy(void *, const void *, size_t);
+extern "C" void *memset(void *, int, size_t);
+extern "C" int sprintf(char *, const char *, ...);
+struct Item { int a, b; char name[16]; };
+EOF
+    for ((i = 0; i < functions; ++i)) ; do
+	cat <<EOF
+int f$i(Item *items, const Item *src, int n, char *buf)
+{
+  memcpy(items, src, sizeof(*items));
+  memset(items + 1, 0, sizeof(Item));
+  int sum = items[0].a + items[1].b + src[n].a;
+  for (int j = 0; j < n; ++j) {
+    sum += items[j].a * 2 + items[j].name[3];
+  }
+  sprintf(buf, "%d", sum);
+  return sum;
+}
+EOF
+    done
+} > bench.cpp
+
+nodes=$(clang -fsyntax-only -Xclang -ast-dump bench.cpp | wc -l)
+
+count () {
+    rm -f count.txt
+    ALLOC_COUNT_FILE="$work/count.txt" LD_PRELOAD="$preload" \
+	clang -fsyntax-only "$@" bench.cpp
+    # The driver may spawn a separate -cc1 process; use the largest.
+    sort -n count.txt | tail -n 1
+}
+
+baseline=$(count)
+with_plugin=$(count -Xclang -load -Xclang "$plugin" \
+    -Xclang -add-plugin -Xclang htcondor-analysis)
+
+extra=$((with_plugin - baseline))
+echo "AST nodes:              $nodes"
+echo "allocations (clang):    $baseline"
+echo "allocations (plugin):   $with_plugin"
+echo "plugin allocations per 1000 nodes: $((extra * 1000 / nodes))"
@@ -0,0 +1,55 @@
+#!/bin/bash
+# Measures the per-invocation overhead of the analysis plugin on tiny
+# translation units, as produced by configure-style checks.
+#
+# Compiles COUNT trivial files in a directory several levels below
+# the database, once without the plugin, once with the plugin
+# searching for the database, and once with HTCONDOR_ANALYZER_DATABASE
+# set.  Prints the average time per compiler invocation.
+#
+# Usage: bench/plugin-startup.sh [COUNT]
+
+set -e
+
+bench=$(cd "$(dirname "$0")" && pwd)
+top=$(dirname "$bench")
+plugin="${HTCONDOR_ANALYSIS_PLUGIN:-$top/plugin.so}"
+count="${1:-200}"
+
+for f in "$plugin" "$top/create-db" ; do
+    if ! test -e "$f" ; then
+	echo "error: $f not found (run \"make bench-plugin-startup\")" 1>&2
+	exit 1
+    fi
+done
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+"$top/create-db"
+deep="$work/a/b/c/d/e/f/g/h"
+mkdir -p "$deep"
+cd "$deep"
+echo 'int main(void) { return 0; }' > conftest.c
+
+run () {
+    local start end
+    start=$(date +%s%N)
+    for ((i = 0; i < count; ++i)) ; do
+	clang -fsyntax-only "$@" conftest.c
+    done
+    end=$(date +%s%N)
+    echo $(( (end - start) / count / 1000 ))
+}
+
+plugin_args="-Xclang -load -Xclang $plugin -Xclang -add-plugin -Xclang htcondor-analysis"
+
+baseline=$(run)
+search=$(run $plugin_args)
+located=$(HTCONDOR_ANALYZER_DATABASE="$work/htcondor-analyzer.sqlite" \
+    run $plugin_args)
+
+echo "microseconds per invocation ($count invocations):"
+echo "  without plugin:                     $baseline"
+echo "  plugin, database search:            $search"
+echo "  plugin, HTCONDOR_ANALYZER_DATABASE: $located"
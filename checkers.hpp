@@ -0,0 +1,1687 @@
+/*
+ * Copyright (C) 2012 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checker infrastructure and the checkers themselves, shared by the
+// Clang plugin (plugin.cpp) and the standalone driver (analyze.cpp).
+// Each program includes this file once.
+
+#pragma once
+
+#include "db-file.hpp"
+#include "file.hpp"
+#include "util.hpp"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "clang/AST/ASTConsumer.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/AST/AST.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Basic/Builtins.h"
+#include "clang/Lex/Lexer.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+namespace {
+
+void
+FatalError(DiagnosticsEngine &D, const std::string &message)
+{
+  unsigned Fatal = D.getCustomDiagID
+    (DiagnosticsEngine::Fatal, "(htcondor-analysis) " + message);
+  D.Report(Fatal);
+}
+
+void
+FatalError(DiagnosticsEngine &D, SourceLocation Pos, const std::string &message)
+{
+  unsigned Fatal = D.getCustomDiagID
+    (DiagnosticsEngine::Fatal, "(htcondor-analysis) " + message);
+  D.Report(Pos, Fatal);
+}
+
+double
+Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// A finding recorded during a parallel traversal.  Only the raw
+// location is kept.  The file, line and fingerprint are determined
+// after all worker threads have finished, because the SourceManager
+// is not thread-safe.
+struct PendingReport {
+  SourceLocation Location;
+  const FunctionDecl *Function;	// enclosing function, for the fingerprint
+  std::string Tool;
+  std::string Message;
+  unsigned Occurrences;
+};
+
+typedef std::vector<PendingReport> PendingReportList;
+
+// Locks the mutex for the lifetime of the object.  A NULL mutex is
+// not locked (used for sequential traversals).
+class MutexGuard {
+  pthread_mutex_t *Mutex;
+
+public:
+  explicit MutexGuard(pthread_mutex_t *M)
+    : Mutex(M)
+  {
+    if (Mutex != NULL) {
+      pthread_mutex_lock(Mutex);
+    }
+  }
+
+  ~MutexGuard()
+  {
+    if (Mutex != NULL) {
+      pthread_mutex_unlock(Mutex);
+    }
+  }
+
+private:
+  MutexGuard(const MutexGuard &); // not implemented
+  MutexGuard &operator=(const MutexGuard &); // not implemented
+};
+
+// Settings from the command line which apply to all checkers.
+struct CheckerOptions {
+  // Declarations in files under these prefixes are not checked.
+  PathPrefixSet Excluded;
+
+  // Tools whose findings are counted per enclosing function and
+  // reported once, at the function, instead of individually.
+  std::set<std::string> Aggregated;
+
+  bool isAggregated(const char *Tool) const
+  {
+    return !Aggregated.empty() && Aggregated.count(Tool) > 0;
+  }
+};
+
+template <class Visitor>
+class ConsumerFromVisitor : public ASTConsumer {
+  std::tr1::shared_ptr<FileIdentificationDatabase> FileDB;
+  std::tr1::shared_ptr<const CheckerOptions> Options;
+  unsigned Jobs;
+  pthread_mutex_t *CommitLock;
+
+public:
+  // If CommitLock is not NULL, it is held during the commit, so that
+  // several translation units can share one database connection.
+  ConsumerFromVisitor(std::tr1::shared_ptr<FileIdentificationDatabase> DB,
+		      std::tr1::shared_ptr<const CheckerOptions> options,
+		      unsigned jobs, pthread_mutex_t *commitLock = NULL)
+    : FileDB(DB), Options(options), Jobs(jobs), CommitLock(commitLock)
+  {
+  }
+
+  virtual void HandleTranslationUnit(ASTContext &Context) {
+    if (Context.getDiagnostics().hasErrorOccurred()) {
+      return;
+    }
+    double Start = Now();
+    RecordFiles(Context);
+    // Declarations loaded lazily from an external source (such as a
+    // pre-compiled header) modify the AST during the traversal, so
+    // they rule out parallel traversal.
+    if (Jobs > 1 && Context.getExternalSource() == NULL) {
+      if (!TraverseParallel(Context)) {
+	return;
+      }
+    } else {
+      Visitor visitor(FileDB, Options, Context);
+      visitor.TraverseDecl(Context.getTranslationUnitDecl());
+    }
+    if (Context.getDiagnostics().hasErrorOccurred()) {
+      return;
+    }
+    double Traversed = Now();
+    {
+      MutexGuard Guard(CommitLock);
+      if (!FileDB->Commit()) {
+	FatalError(Context.getDiagnostics(),
+		   "commit: " + FileDB->ErrorMessage());
+	return;
+      }
+    }
+    WriteStatistics(Context, Traversed - Start, Now() - Traversed);
+  }
+
+private:
+  // State shared by the threads of a parallel traversal.
+  struct ParallelState {
+    std::tr1::shared_ptr<FileIdentificationDatabase> FileDB;
+    std::tr1::shared_ptr<const CheckerOptions> Options;
+    ASTContext *Context;
+    std::vector<Decl *> Decls;
+    // One list per element of Decls, so that the findings are
+    // recorded in the same order as in a sequential traversal.
+    std::vector<PendingReportList> Pending;
+    size_t Next;		// next element of Decls to traverse
+    pthread_mutex_t Lock;	// for ASTContext and SourceManager
+  };
+
+  // Adds the declarations in DC to Decls.  The members of namespaces
+  // and linkage specifications are added individually, so that they
+  // can be distributed among the threads.
+  static void CollectDecls(DeclContext *DC, std::vector<Decl *> &Decls)
+  {
+    for (DeclContext::decl_iterator p = DC->decls_begin(),
+	   end = DC->decls_end(); p != end; ++p) {
+      if (isa<NamespaceDecl>(*p) || isa<LinkageSpecDecl>(*p)) {
+	CollectDecls(cast<DeclContext>(*p), Decls);
+      } else {
+	Decls.push_back(*p);
+      }
+    }
+  }
+
+  static void *TraverseWorker(void *Closure)
+  {
+    ParallelState &State(*static_cast<ParallelState *>(Closure));
+    Visitor visitor(State.FileDB, State.Options, *State.Context);
+    while (true) {
+      size_t i = __sync_fetch_and_add(&State.Next, 1);
+      if (i >= State.Decls.size()) {
+	break;
+      }
+      visitor.setParallel(&State.Pending[i], &State.Lock);
+      visitor.TraverseCheckedDecl(State.Decls[i]);
+    }
+    return NULL;
+  }
+
+  // Distributes the top-level declarations among Jobs threads (the
+  // current thread included), and records the findings afterwards.
+  bool TraverseParallel(ASTContext &Context)
+  {
+    ParallelState State;
+    State.FileDB = FileDB;
+    State.Options = Options;
+    State.Context = &Context;
+    std::vector<Decl *> Decls;
+    CollectDecls(Context.getTranslationUnitDecl(), Decls);
+    // The exclusions are checked here, so that the worker threads do
+    // not need the SourceManager for the top-level declarations.
+    Visitor Main(FileDB, Options, Context);
+    for (std::vector<Decl *>::const_iterator p = Decls.begin(),
+	   end = Decls.end(); p != end; ++p) {
+      if (!Main.isSkipped(*p)) {
+	State.Decls.push_back(*p);
+      }
+    }
+    State.Pending.resize(State.Decls.size());
+    State.Next = 0;
+    pthread_mutex_init(&State.Lock, NULL);
+
+    std::vector<pthread_t> Threads;
+    for (unsigned i = 1; i < Jobs; ++i) {
+      pthread_t Thread;
+      if (pthread_create(&Thread, NULL, TraverseWorker, &State) != 0) {
+	// The remaining threads process the declarations.
+	break;
+      }
+      Threads.push_back(Thread);
+    }
+    TraverseWorker(&State);
+    for (std::vector<pthread_t>::iterator p = Threads.begin(),
+	   end = Threads.end(); p != end; ++p) {
+      pthread_join(*p, NULL);
+    }
+    pthread_mutex_destroy(&State.Lock);
+
+    // Locations, exclusions and fingerprints are resolved on this
+    // thread, without the lock.
+    for (std::vector<PendingReportList>::const_iterator
+	   p = State.Pending.begin(), end = State.Pending.end();
+	 p != end; ++p) {
+      for (PendingReportList::const_iterator q = p->begin(),
+	     qend = p->end(); q != qend; ++q) {
+	Main.RecordPending(*q);
+	if (Context.getDiagnostics().hasErrorOccurred()) {
+	  return false;
+	}
+      }
+    }
+    return true;
+  }
+
+public:
+
+  // Appends a line to the file named by the HTCONDOR_ANALYSIS_STATS
+  // environment variable, for the benchmarks.  The tab-separated
+  // fields are the main file, the traversal and commit times in
+  // seconds, and the number of transaction retries.
+  void WriteStatistics(ASTContext &Context, double Traversal, double Commit)
+  {
+    const char *Path = getenv("HTCONDOR_ANALYSIS_STATS");
+    if (Path == NULL || *Path == '\0') {
+      return;
+    }
+    const SourceManager &SM(Context.getSourceManager());
+    const FileEntry *Main = SM.getFileEntryForID(SM.getMainFileID());
+    std::string Line;
+    FormatString(Line, "%s\t%.6f\t%.6f\t%u\n",
+		 Main != NULL ? Main->getName() : "-",
+		 Traversal, Commit, FileDB->Retries());
+    // A single write, so that the lines of parallel compiler
+    // processes do not interleave.
+    int fd = open(Path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+    if (fd >= 0) {
+      ssize_t ret = write(fd, Line.data(), Line.size());
+      (void) ret;
+      close(fd);
+    }
+  }
+
+  // Marks the files of the translation unit for processing.  System
+  // headers and files under the excluded prefixes are not recorded,
+  // because no findings are reported for them.  Only the local
+  // entries of the SourceManager are considered: files loaded from a
+  // pre-compiled header were recorded, with their findings, when the
+  // header was built.  The main file is passed to SetMainFile, so
+  // that the files are recorded as its includes.
+  void RecordFiles(ASTContext &Context)
+  {
+    const SourceManager &SrcMan = Context.getSourceManager();
+    const FileEntry *Main = SrcMan.getFileEntryForID(SrcMan.getMainFileID());
+    if (Main != NULL) {
+      FileDB->SetMainFile(Main->getName());
+    }
+    llvm::SmallPtrSet<const FileEntry *, 64> Seen;
+    for (unsigned i = 0, n = SrcMan.local_sloc_entry_size(); i < n; ++i) {
+      const SrcMgr::SLocEntry &Entry = SrcMan.getLocalSLocEntry(i);
+      if (!Entry.isFile()) {
+	continue;
+      }
+      const SrcMgr::FileInfo &File = Entry.getFile();
+      if (File.getFileCharacteristic() != SrcMgr::C_User) {
+	continue;
+      }
+      const SrcMgr::ContentCache *CCache = File.getContentCache();
+      const FileEntry *FEntry = CCache->ContentsEntry;
+      if (!FEntry) {
+	FEntry = CCache->OrigEntry;
+      }
+      if (!FEntry || !Seen.insert(FEntry)) {
+	continue;
+      }
+      if (!Options->Excluded.empty()) {
+	std::string Path;
+	if (!ResolvePath(FEntry->getName(), Path)) {
+	  Path = FEntry->getName();
+	}
+	if (Options->Excluded.Matches(Path)) {
+	  continue;
+	}
+      }
+      FileDB->MarkForProcessing(FEntry->getName());
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Checker infrastructure
+//
+// Each check is implemented by a checker class.  Checkers are combined
+// into compile-time lists, and CheckerVisitor turns such a list into a
+// single RecursiveASTVisitor.  For each node kind, the visitor calls
+// only the checkers which list the kind in their Kinds constant, so
+// there is no run-time dispatch.
+
+// Node kinds for the Kinds constant of checkers.
+struct Visits {
+  typedef enum Enum {
+    Call = 1 << 0,		// CallExpr, including member calls
+    MemberCall = 1 << 1,	// CXXMemberCallExpr
+    OperatorCall = 1 << 2,	// CXXOperatorCallExpr
+    UnaryOp = 1 << 3,		// UnaryOperator
+    BinaryOp = 1 << 4,		// BinaryOperator
+    ArraySubscript = 1 << 5,	// ArraySubscriptExpr
+    Var = 1 << 6		// VarDecl
+  } Enum;
+private:
+  Visits();			// not implemented
+  ~Visits();			// not implemented
+};
+
+// Classification of record types, used by the checks for MyString and
+// the standard library containers.
+struct TypeClass {
+  typedef enum Enum {
+    Other,			// Any other type
+    MyString,			// class MyString
+    Vector,			// std::vector<...>
+    BasicString,		// std::basic_string<...>
+    Array			// std::array<...>
+  } Enum;
+private:
+  TypeClass();			// not implemented
+  ~TypeClass();			// not implemented
+};
+
+// State shared by all checkers during the traversal of a translation
+// unit.
+class CheckerContext {
+public:
+  ASTContext &Context;
+  std::tr1::shared_ptr<FileIdentificationDatabase> FileDB;
+
+  // Innermost function whose body is being traversed, or NULL.
+  const FunctionDecl *CurrentFunction;
+
+  // Set during parallel traversals.  Findings are appended to
+  // Pending instead of being passed to FileDB (see RecordPending),
+  // and Lock serializes the operations which update caches in the
+  // ASTContext or the SourceManager.
+  PendingReportList *Pending;
+  pthread_mutex_t *Lock;
+
+  CheckerContext(std::tr1::shared_ptr<FileIdentificationDatabase> DB,
+		 std::tr1::shared_ptr<const CheckerOptions> options,
+		 ASTContext &C)
+    : Context(C), FileDB(DB), CurrentFunction(NULL),
+      Pending(NULL), Lock(NULL), Options(options),
+      FunctionHashDecl(NULL), FunctionHash(0), FormatStream(FormatBuffer)
+  {
+  }
+
+  // Returns a stream for building report messages.  The buffer is
+  // reused for all messages, so formatting does not allocate once it
+  // has grown large enough.  Formatted() returns the text.
+  llvm::raw_ostream &Formatter()
+  {
+    FormatStream.flush();
+    FormatBuffer.clear();
+    return FormatStream;
+  }
+
+  const std::string &Formatted()
+  {
+    return FormatStream.str();
+  }
+
+  // Returns the classification of the unqualified canonical type.
+  // The result is cached per declaration.
+  TypeClass::Enum Classify(QualType Type)
+  {
+    QualType UType = Type.getCanonicalType().getUnqualifiedType();
+    const RecordType *RType = dyn_cast<RecordType>(UType.getTypePtr());
+    if (RType == NULL) {
+      return TypeClass::Other;
+    }
+    const RecordDecl *Decl = RType->getDecl();
+    llvm::DenseMap<const RecordDecl *, TypeClass::Enum>::iterator p =
+      TypeClasses.find(Decl);
+    if (p != TypeClasses.end()) {
+      return p->second;
+    }
+    TypeClass::Enum Class = TypeClass::Other;
+    if (const ClassTemplateSpecializationDecl *Spec =
+	dyn_cast<ClassTemplateSpecializationDecl>(Decl)) {
+      const std::string Name
+	(Spec->getSpecializedTemplate()->getQualifiedNameAsString());
+      if (Name == "std::vector") {
+	Class = TypeClass::Vector;
+      } else if (Name == "std::basic_string") {
+	Class = TypeClass::BasicString;
+      } else if (Name == "std::array") {
+	Class = TypeClass::Array;
+      }
+    } else if (Decl->getQualifiedNameAsString() == "MyString") {
+      Class = TypeClass::MyString;
+    }
+    TypeClasses[Decl] = Class;
+    return Class;
+  }
+
+  // Returns Type.getAsString().  The result is cached, so each
+  // distinct type is printed once per translation unit.
+  const std::string &TypeName(QualType Type)
+  {
+    const std::string *&Name = TypeNames[Type.getAsOpaquePtr()];
+    if (Name == NULL) {
+      TypeNameStorage.push_back(Type.getAsString());
+      Name = &TypeNameStorage.back();
+    }
+    return *Name;
+  }
+
+  // Returns true if the declaration is in a system header or in a
+  // file under one of the excluded path prefixes.  The result is
+  // cached per file.
+  bool isExcluded(const Decl *D)
+  {
+    SourceLocation Location = D->getLocation();
+    if (!Location.isValid()) {
+      return false;
+    }
+    MutexGuard Guard(Lock);
+    return isExcludedFile
+      (Context.getSourceManager().getExpansionLoc(Location));
+  }
+
+private:
+  // Implementation of isExcluded.  Location must be a file location.
+  // During parallel traversals, the caller must hold Lock.
+  bool isExcludedFile(SourceLocation Location)
+  {
+    SourceManager &SM(Context.getSourceManager());
+    FileID File = SM.getFileID(Location);
+    llvm::DenseMap<FileID, bool>::iterator p = ExcludedFiles.find(File);
+    if (p != ExcludedFiles.end()) {
+      return p->second;
+    }
+    bool Result = SM.isInSystemHeader(Location);
+    if (!Result && !Options->Excluded.empty()) {
+      if (const FileEntry *Entry = SM.getFileEntryForID(File)) {
+	std::string Path;
+	if (!ResolvePath(Entry->getName(), Path)) {
+	  Path = Entry->getName();
+	}
+	Result = Options->Excluded.Matches(Path);
+      }
+    }
+    ExcludedFiles[File] = Result;
+    return Result;
+  }
+
+public:
+
+  // Constant evaluation may compute and cache record layouts.
+  bool EvaluateAsInt(const Expr *E, llvm::APSInt &Result)
+  {
+    MutexGuard Guard(Lock);
+    return E->EvaluateAsInt(Result, Context);
+  }
+
+  bool EvaluateAsBooleanCondition(const Expr *E, bool &Result)
+  {
+    MutexGuard Guard(Lock);
+    return E->EvaluateAsBooleanCondition(Result, Context);
+  }
+
+  // Records a finding.  Findings of aggregated tools within a
+  // function are only counted, see FlushAggregates.
+  void Report(SourceLocation Location, const char *Tool,
+	      const std::string &Message)
+  {
+    if (CurrentFunction != NULL && Options->isAggregated(Tool)) {
+      ++Aggregates[AggregateKey(CurrentFunction,
+				std::make_pair(std::string(Tool), Message))];
+      return;
+    }
+    Record(Location, Tool, Message, 1);
+  }
+
+  // Records a finding collected by a parallel traversal.  Must be
+  // called on a context which is not in parallel mode.
+  void RecordPending(const PendingReport &PR)
+  {
+    const FunctionDecl *Outer = CurrentFunction;
+    CurrentFunction = PR.Function;
+    Record(PR.Location, PR.Tool.c_str(), PR.Message, PR.Occurrences);
+    CurrentFunction = Outer;
+  }
+
+  // Reports the aggregated findings for the function, at its
+  // location, and forgets them.  Called when the traversal leaves the
+  // function body.
+  void FlushAggregates(const FunctionDecl *Function)
+  {
+    AggregateMap::iterator p = Aggregates.lower_bound
+      (AggregateKey(Function, std::make_pair(std::string(), std::string())));
+    AggregateMap::iterator end = p;
+    for (; end != Aggregates.end() && end->first.first == Function; ++end) {
+      Record(Function->getLocation(), end->first.second.first.c_str(),
+	     end->first.second.second, end->second);
+    }
+    Aggregates.erase(p, end);
+  }
+
+private:
+  void Record(SourceLocation Location, const char *Tool,
+	      const std::string &Message, unsigned Occurrences)
+  {
+    if (Pending != NULL) {
+      PendingReport PR;
+      PR.Location = Location;
+      PR.Function = CurrentFunction;
+      PR.Tool = Tool;
+      PR.Message = Message;
+      PR.Occurrences = Occurrences;
+      Pending->push_back(PR);
+      return;
+    }
+    if (!Location.isValid()) {
+      FatalError(Context.getDiagnostics(),
+		 "attempt to report at an invalid source location");
+      return;
+    }
+
+    if (!FileDB->isOpen()) {
+      return;
+    }
+
+    // This obtains the source code location of the outmost macro call.
+    SourceManager &SM(Context.getSourceManager());
+    SourceLocation OuterLocation = Location;
+    while (OuterLocation.isMacroID()) {
+      OuterLocation = SM.getImmediateMacroCallerLoc(OuterLocation);
+    }
+    if (SM.isLoadedSourceLocation(OuterLocation)
+	|| isExcludedFile(OuterLocation)) {
+      // The file is not recorded by RecordFiles.
+      return;
+    }
+    PresumedLoc PLoc = SM.getPresumedLoc(OuterLocation);
+    if (PLoc.isInvalid()) {
+      FatalError(Context.getDiagnostics(),
+		 "attempt to report at an invalid presumed location");
+      return;
+    }
+
+    const char *FileName = PLoc.getFilename();
+    unsigned Line = PLoc.getLine();
+    unsigned Column = PLoc.getColumn();
+    unsigned long long Hash = Fingerprint(OuterLocation, Tool, Message);
+    if (!FileDB->Report(FileName, Line, Column, Tool, Message, Hash,
+			Occurrences)) {
+      FatalError(Context.getDiagnostics(), Location,
+		 "could not report: " + FileDB->ErrorMessage());
+      return;
+    }
+  }
+
+  std::tr1::shared_ptr<const CheckerOptions> Options;
+  llvm::DenseMap<FileID, bool> ExcludedFiles;
+
+  // Counts of aggregated findings by function, tool and message.
+  typedef std::pair<const FunctionDecl *,
+		    std::pair<std::string, std::string> > AggregateKey;
+  typedef std::map<AggregateKey, unsigned> AggregateMap;
+  AggregateMap Aggregates;
+
+  llvm::DenseMap<const RecordDecl *, TypeClass::Enum> TypeClasses;
+  llvm::DenseMap<void *, const std::string *> TypeNames;
+  std::deque<std::string> TypeNameStorage; // stable element addresses
+
+  // Cached hash of the qualified name of FunctionHashDecl.
+  const FunctionDecl *FunctionHashDecl;
+  unsigned long long FunctionHash;
+
+  std::string FormatBuffer;
+  llvm::raw_string_ostream FormatStream;
+
+  // Number of tokens which contribute to the fingerprint.
+  static const unsigned FingerprintTokens = 32;
+
+  // Computes a hash which identifies the finding independently of its
+  // line and column, so that it survives edits elsewhere in the file.
+  // It covers the tool, the message, the enclosing function, and the
+  // tokens on the source line, which makes it insensitive to
+  // whitespace changes.
+  unsigned long long Fingerprint(SourceLocation Location, const char *Tool,
+				 const std::string &Message)
+  {
+    unsigned long long Hash = HashInitial;
+    Hash = HashString(Hash, Tool);
+    Hash = HashString(Hash, Message);
+    if (CurrentFunction != NULL) {
+      if (CurrentFunction != FunctionHashDecl) {
+	FunctionHashDecl = CurrentFunction;
+	FunctionHash = HashString
+	  (HashInitial, CurrentFunction->getQualifiedNameAsString());
+      }
+      Hash = HashBytes(Hash, &FunctionHash, sizeof(FunctionHash));
+    }
+
+    SourceManager &SM(Context.getSourceManager());
+    std::pair<FileID, unsigned> Decomposed = SM.getDecomposedLoc(Location);
+    bool Invalid = false;
+    StringRef Buffer = SM.getBufferData(Decomposed.first, &Invalid);
+    if (Invalid) {
+      return Hash;
+    }
+    unsigned LineStart = Decomposed.second;
+    while (LineStart > 0 && Buffer[LineStart - 1] != '\n') {
+      --LineStart;
+    }
+    Lexer RawLexer(SM.getLocForStartOfFile(Decomposed.first),
+		   Context.getLangOpts(), Buffer.begin(),
+		   Buffer.begin() + LineStart, Buffer.end());
+    Token Tok;
+    for (unsigned i = 0; i < FingerprintTokens; ++i) {
+      // LexFromRawLexer returns true along with the last token of the
+      // buffer, so the end is detected by the eof token instead.
+      bool AtEnd = RawLexer.LexFromRawLexer(Tok);
+      if (Tok.is(tok::eof) || (i > 0 && Tok.isAtStartOfLine())) {
+	break;
+      }
+      Hash = HashBytes(Hash, SM.getCharacterData(Tok.getLocation()),
+		       Tok.getLength());
+      Hash = HashBytes(Hash, "", 1);
+      if (AtEnd) {
+	break;
+      }
+    }
+    return Hash;
+  }
+};
+
+// Base class of all checkers.  It provides empty functions for all
+// node kinds.  Checkers override those listed in their Kinds
+// constant.
+class Checker {
+protected:
+  CheckerContext &Shared;
+  ASTContext &Context;
+
+  Checker(CheckerContext &C)
+    : Shared(C), Context(C.Context)
+  {
+  }
+
+  void Report(SourceLocation Location, const char *Tool,
+	      const std::string &Message)
+  {
+    Shared.Report(Location, Tool, Message);
+  }
+
+  llvm::raw_ostream &Formatter()
+  {
+    return Shared.Formatter();
+  }
+
+  const std::string &Formatted()
+  {
+    return Shared.Formatted();
+  }
+
+  bool EvaluateAsInt(const Expr *E, llvm::APSInt &Result)
+  {
+    return Shared.EvaluateAsInt(E, Result);
+  }
+
+  bool EvaluateAsBooleanCondition(const Expr *E, bool &Result)
+  {
+    return Shared.EvaluateAsBooleanCondition(E, Result);
+  }
+
+  static CXXMethodDecl *getMethodDecl(const CXXMemberCallExpr *Expr) {
+    if (const MemberExpr *MemExpr = 
+	dyn_cast<MemberExpr>(Expr->getCallee()->IgnoreParens())) {
+      return cast<CXXMethodDecl>(MemExpr->getMemberDecl());
+    }   
+    return 0;
+  }
+
+public:
+  void VisitCallExpr(CallExpr *) { }
+  void VisitCXXMemberCallExpr(CXXMemberCallExpr *) { }
+  void VisitCXXOperatorCallExpr(CXXOperatorCallExpr *) { }
+  void VisitUnaryOperator(UnaryOperator *) { }
+  void VisitBinaryOperator(BinaryOperator *) { }
+  void VisitArraySubscriptExpr(ArraySubscriptExpr *) { }
+  void VisitVarDecl(VarDecl *) { }
+};
+
+// Compile-time list of checkers:
+// CheckerList<A, CheckerList<B, CheckerList<C> > >.
+struct CheckerListEnd { };
+template <class Head, class Tail = CheckerListEnd> struct CheckerList { };
+
+// Instantiates the checkers in a list and forwards nodes to them.
+template <class List> class CheckerSet;
+
+template <>
+class CheckerSet<CheckerListEnd> {
+public:
+  static const unsigned Kinds = 0;
+
+  CheckerSet(CheckerContext &)
+  {
+  }
+
+  void VisitCallExpr(CallExpr *) { }
+  void VisitCXXMemberCallExpr(CXXMemberCallExpr *) { }
+  void VisitCXXOperatorCallExpr(CXXOperatorCallExpr *) { }
+  void VisitUnaryOperator(UnaryOperator *) { }
+  void VisitBinaryOperator(BinaryOperator *) { }
+  void VisitArraySubscriptExpr(ArraySubscriptExpr *) { }
+  void VisitVarDecl(VarDecl *) { }
+};
+
+template <class Head, class Tail>
+class CheckerSet<CheckerList<Head, Tail> > {
+  Head First;
+  CheckerSet<Tail> Rest;
+
+public:
+  static const unsigned Kinds = Head::Kinds | CheckerSet<Tail>::Kinds;
+
+  CheckerSet(CheckerContext &C)
+    : First(C), Rest(C)
+  {
+  }
+
+  // The conditions are constant, so calls to checkers which do not
+  // handle a node kind are eliminated by the compiler.
+
+  void VisitCallExpr(CallExpr *E)
+  {
+    if (Head::Kinds & Visits::Call) {
+      First.VisitCallExpr(E);
+    }
+    Rest.VisitCallExpr(E);
+  }
+
+  void VisitCXXMemberCallExpr(CXXMemberCallExpr *E)
+  {
+    if (Head::Kinds & Visits::MemberCall) {
+      First.VisitCXXMemberCallExpr(E);
+    }
+    Rest.VisitCXXMemberCallExpr(E);
+  }
+
+  void VisitCXXOperatorCallExpr(CXXOperatorCallExpr *E)
+  {
+    if (Head::Kinds & Visits::OperatorCall) {
+      First.VisitCXXOperatorCallExpr(E);
+    }
+    Rest.VisitCXXOperatorCallExpr(E);
+  }
+
+  void VisitUnaryOperator(UnaryOperator *E)
+  {
+    if (Head::Kinds & Visits::UnaryOp) {
+      First.VisitUnaryOperator(E);
+    }
+    Rest.VisitUnaryOperator(E);
+  }
+
+  void VisitBinaryOperator(BinaryOperator *E)
+  {
+    if (Head::Kinds & Visits::BinaryOp) {
+      First.VisitBinaryOperator(E);
+    }
+    Rest.VisitBinaryOperator(E);
+  }
+
+  void VisitArraySubscriptExpr(ArraySubscriptExpr *E)
+  {
+    if (Head::Kinds & Visits::ArraySubscript) {
+      First.VisitArraySubscriptExpr(E);
+    }
+    Rest.VisitArraySubscriptExpr(E);
+  }
+
+  void VisitVarDecl(VarDecl *D)
+  {
+    if (Head::Kinds & Visits::Var) {
+      First.VisitVarDecl(D);
+    }
+    Rest.VisitVarDecl(D);
+  }
+};
+
+// The traversal for a list of checkers.
+template <class Checkers>
+class CheckerVisitor : public RecursiveASTVisitor<CheckerVisitor<Checkers> > {
+  typedef RecursiveASTVisitor<CheckerVisitor<Checkers> > Base;
+  CheckerContext Shared;
+  CheckerSet<Checkers> Set;
+
+public:
+  CheckerVisitor(std::tr1::shared_ptr<FileIdentificationDatabase> DB,
+		 std::tr1::shared_ptr<const CheckerOptions> Options,
+		 ASTContext &C)
+    : Shared(DB, Options, C), Set(Shared)
+  {
+  }
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  // Switches to parallel mode (see CheckerContext::Pending).
+  void setParallel(PendingReportList *Pending, pthread_mutex_t *Lock)
+  {
+    Shared.Pending = Pending;
+    Shared.Lock = Lock;
+  }
+
+  // Declarations in system headers and excluded files are skipped,
+  // together with their members and template instantiations.  Only
+  // declarations at namespace scope need to be checked.
+  // Declarations deserialized from a pre-compiled header were checked
+  // when the header was built.
+  bool isSkipped(Decl *D)
+  {
+    return D != NULL && !isa<TranslationUnitDecl>(D)
+      && D->getDeclContext()->isFileContext()
+      && (D->isFromASTFile() || Shared.isExcluded(D));
+  }
+
+  void RecordPending(const PendingReport &PR)
+  {
+    Shared.RecordPending(PR);
+  }
+
+  bool TraverseDecl(Decl *D)
+  {
+    if (isSkipped(D)) {
+      return true;
+    }
+    return TraverseCheckedDecl(D);
+  }
+
+  // Traverses D, for which isSkipped has returned false.
+  bool TraverseCheckedDecl(Decl *D)
+  {
+    const FunctionDecl *Outer = Shared.CurrentFunction;
+    const FunctionDecl *FD = dyn_cast_or_null<FunctionDecl>(D);
+    if (FD != NULL) {
+      Shared.CurrentFunction = FD;
+    }
+    bool Result = Base::TraverseDecl(D);
+    if (FD != NULL) {
+      Shared.FlushAggregates(FD);
+    }
+    Shared.CurrentFunction = Outer;
+    return Result;
+  }
+
+  bool VisitCallExpr(CallExpr *E)
+  {
+    Set.VisitCallExpr(E);
+    return true;
+  }
+
+  bool VisitCXXMemberCallExpr(CXXMemberCallExpr *E)
+  {
+    Set.VisitCXXMemberCallExpr(E);
+    return true;
+  }
+
+  bool VisitCXXOperatorCallExpr(CXXOperatorCallExpr *E)
+  {
+    Set.VisitCXXOperatorCallExpr(E);
+    return true;
+  }
+
+  bool VisitUnaryOperator(UnaryOperator *E)
+  {
+    Set.VisitUnaryOperator(E);
+    return true;
+  }
+
+  bool VisitBinaryOperator(BinaryOperator *E)
+  {
+    Set.VisitBinaryOperator(E);
+    return true;
+  }
+
+  bool VisitArraySubscriptExpr(ArraySubscriptExpr *E)
+  {
+    Set.VisitArraySubscriptExpr(E);
+    return true;
+  }
+
+  bool VisitVarDecl(VarDecl *D)
+  {
+    Set.VisitVarDecl(D);
+    return true;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Register_Command
+
+class RegisterCommandChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::MemberCall;
+
+  RegisterCommandChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitCXXMemberCallExpr(CXXMemberCallExpr *Expr)
+  {
+    ProcessRegisterCommand(Expr);
+  }
+
+private:
+  void ProcessRegisterCommand(CXXMemberCallExpr *Expr)
+  {
+    const CXXMethodDecl *MethodDecl = getMethodDecl(Expr);
+    if (MethodDecl == NULL) {
+      return;
+    }
+    if (const IdentifierInfo *Identifier = MethodDecl->getIdentifier()) {
+      StringRef MethodName(Identifier->getName());
+      if (MethodName == "Register_Command"
+	  || MethodName == "Register_CommandWithPayload") {
+	unsigned numArgs = Expr->getNumArgs();
+	if (numArgs < 5 ) {
+	  Report(Expr->getExprLoc(), "Register_Command",
+		 "call without enough arguments");
+	  return;
+	}
+
+	llvm::APSInt command;
+	if (!EvaluateAsInt(Expr->getArg(0), command)) {
+	  Report(Expr->getExprLoc(), "Register_Command",
+		 "call with non-constant command");
+	  return;
+	}
+
+	llvm::APSInt perm;	// default is ALLOW
+	if (numArgs >= 6) {
+	  if (!EvaluateAsInt(Expr->getArg(5), perm)) {
+	    Report(Expr->getExprLoc(), "Register_Command",
+		   "call with non-constant perm");
+	    return;
+	  }
+	}
+
+	bool forceAuthentication = false;
+	if (numArgs >= 8) {
+	  if (!EvaluateAsBooleanCondition(Expr->getArg(7), forceAuthentication)
+	      && !Expr->getArg(7)->isDefaultArgument()) {
+	    Report(Expr->getExprLoc(), "Register_Command",
+		   "call with non-constant force_authentication");
+	    return;
+	  }
+	}
+
+	Formatter() << MethodName
+		    << " command=" << command << " perm=" << perm
+		    << " auth=" << (forceAuthentication ? "true" : "false");
+	Report(Expr->getExprLoc(), "Register_Command", Formatted());
+      }
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// sprintf
+
+class SprintfChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::Call | Visits::MemberCall;
+
+  SprintfChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitCallExpr(CallExpr *Expr)
+  {
+    ProcessSprintf(Expr);
+  }
+
+  void VisitCXXMemberCallExpr(CXXMemberCallExpr *Expr)
+  {
+    if (const CXXMethodDecl *MethodDecl = getMethodDecl(Expr)) {
+      const IdentifierInfo *Identifier = MethodDecl->getIdentifier();
+      if (Identifier != NULL && isSprintfName(Identifier->getName())) {
+	ProcessSprintfMemberCall(Expr, MethodDecl, Identifier->getName());
+      }
+    }
+  }
+
+private:
+  struct SprintfTarget {
+    typedef enum {
+      None, CharPtr, MyString, StdString, Other
+    } Enum;
+  private:
+    SprintfTarget();
+    ~SprintfTarget();
+  };
+
+  void ProcessSprintf(CallExpr *Expr)
+  {
+    FunctionDecl *Decl = Expr->getDirectCallee();
+    if (Decl == NULL) {
+      return;
+    }
+    const IdentifierInfo *Identifier = Decl->getIdentifier();
+    if (Identifier != NULL && isSprintfName(Identifier->getName())) {
+      StringRef FunctionName(Identifier->getName());
+      SprintfTarget::Enum Target = getSprintfTarget(Decl);
+      switch (Target) {
+      case SprintfTarget::None:
+	break;
+      case SprintfTarget::CharPtr:
+	Formatter() << FunctionName;
+	Report(Expr->getExprLoc(), "sprintf", Formatted());
+	break;
+      case SprintfTarget::MyString:
+	Formatter() << FunctionName << "(MyString)";
+	Report(Expr->getExprLoc(), "sprintf-overload", Formatted());
+	break;
+      case SprintfTarget::StdString:
+	Formatter() << FunctionName << "(std::string)";
+	Report(Expr->getExprLoc(), "sprintf-overload", Formatted());
+	break;
+      case SprintfTarget::Other:
+	{
+	  llvm::raw_ostream &OS = Formatter();
+	  OS << FunctionName << '(';
+#if 0
+	  std::unique_ptr<ASTConsumer> Printer
+	    (Context.CreateASTPrinter(OS));
+	  Printer->TraverseParamVarDecl(*Decl->param_begin);
+#else
+	  OS << "<unknown>";
+#endif
+	  OS << ')';
+	  Report(Expr->getExprLoc(), "sprintf-overload", Formatted());
+	}
+	break;
+      }
+    }
+  }
+
+  void ProcessSprintfMemberCall(const CXXMemberCallExpr *Expr,
+				const CXXMethodDecl *Decl,
+				StringRef MethodName)
+  {
+    Formatter() << MethodName << '('
+		<< Decl->getParent()->getQualifiedNameAsString() << ')';
+    Report(Expr->getCallee()->getExprLoc(), "sprintf-overload", Formatted());
+  }
+
+  static bool isSprintfName(StringRef Name) {
+    return Name == "sprintf" || Name == "vsprintf";
+  }
+
+  static SprintfTarget::Enum getSprintfTarget(FunctionDecl *Decl) {
+    if (Decl->getNumParams() < 2) {
+      return SprintfTarget::None;
+    }
+    ParmVarDecl *First = *Decl->param_begin();
+    QualType FirstType = First->getType().getCanonicalType();
+    if (FirstType->isPointerType()
+	&& FirstType->getPointeeType()->isCharType()) {
+      return SprintfTarget::CharPtr;
+    }
+    if (FirstType->isReferenceType()) {
+      QualType RefedType = FirstType->getPointeeType();
+      if (const RecordType *StructType = dyn_cast<RecordType>(RefedType)) {
+	RecordDecl *TypeDecl = StructType->getDecl();
+	std::string Name = TypeDecl->getQualifiedNameAsString();
+	if (Name == "MyString" ) {
+	  return SprintfTarget::MyString;
+	} else if (Name == "std::basic_string") {
+	  return SprintfTarget::StdString;
+	}
+      }
+    }
+    return SprintfTarget::Other;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// strcpy/strcat
+
+class StrcpyChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::Call;
+
+  StrcpyChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitCallExpr(CallExpr *Expr)
+  {
+    ProcessStrcpy(Expr);
+  }
+
+private:
+  void ProcessStrcpy(CallExpr *Expr)
+  {
+    FunctionDecl *Decl = Expr->getDirectCallee();
+    if (Decl == NULL) {
+      return;
+    }
+    const IdentifierInfo *Identifier = Decl->getIdentifier();
+    if (Identifier != NULL && isStrcpyName(Identifier->getName())) {
+      std::string ParameterName;
+      if (parameterNameInArgument(Expr, ParameterName)) {
+	Formatter() << Identifier->getName() << '(' << ParameterName << ')';
+	Report(Expr->getExprLoc(), "strcpy", Formatted());
+      }
+    }
+  }
+
+  static bool isStrcpyName(StringRef Name) {
+    return Name == "strcpy" || Name == "strcat" || Name == "sprintf";
+  }
+
+  struct ParameterNameVisitor : RecursiveASTVisitor<ParameterNameVisitor> {
+    std::string &Name;
+    bool Parameter;
+
+    ParameterNameVisitor(std::string &name)
+      : Name(name), Parameter(false)
+    {
+    }
+
+    bool VisitDeclRefExpr(DeclRefExpr *Expr) {
+      if (!Parameter) {
+	if (ParmVarDecl *Parm = dyn_cast<ParmVarDecl>(Expr->getDecl())) {
+	  Parameter = true;
+	  Name = Parm->getNameAsString();
+	}
+      }
+      return true;
+    }
+
+    bool VisitUnaryDeref(UnaryOperator *) {
+      // If we copy into a dereferenced pointer, we likely have a
+      // false positive because the pointee might have been
+      // allocated by us.
+      return false;
+    }
+
+    bool VisitMemberExpr(MemberExpr *Expr) {
+      // -> dereference is also a pointer dereference.
+      return !Expr->isArrow();
+    }
+  };
+
+  static bool parameterNameInArgument(CallExpr *Expr, std::string &name) {
+    if (Expr->getNumArgs() < 2) {
+      return false;
+    }
+    ParameterNameVisitor Visitor(name);
+    Visitor.TraverseStmt(Expr->getArg(0));
+    return Visitor.Parameter;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// MyString
+
+class MyStringChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::OperatorCall;
+
+  MyStringChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitCXXOperatorCallExpr(CXXOperatorCallExpr *Expr)
+  {
+    ProcessMyStringOperator(Expr);
+  }
+
+private:
+  void ProcessMyStringOperator(CXXOperatorCallExpr *Expr)
+  {
+    QualType Type;
+    switch (Expr->getOperator()) {
+    case OO_Subscript:
+      if (matchTypeAgainstMyString(Expr, Type)) {
+	std::string message("operator[] ");
+	if (!Type.isConstQualified()) {
+	  message += "non-";
+	}
+	message += "const";
+	Report(Expr->getExprLoc(), "MyString", message);
+      }
+      break;
+    case OO_PlusEqual:
+      if (matchTypeAgainstMyString(Expr, Type)) {
+	Type = Expr->getArg(1)->getType().getCanonicalType()
+	  .getUnqualifiedType();
+	const std::string &TypeName(Shared.TypeName(Type));
+	if (TypeName != "char"
+	    && TypeName != "const char *" 
+	    && TypeName != "class MyString") {
+	  Report(Expr->getExprLoc(), "MyString", "operator+= " + TypeName);
+	}
+      }
+      break;
+    default:
+      ;
+    }
+  }
+
+  // Returns true if the unqualified type is class MyString, and
+  // and stores the potentially qualified type in the reference.
+  bool matchTypeAgainstMyString(CXXOperatorCallExpr *Expr, QualType &Type)
+  {
+    Type = Expr->getArg(0)->getType();
+    return Shared.Classify(Type) == TypeClass::MyString;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// sizeof and pointers
+
+class SizeofPointerChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::Call;
+
+  SizeofPointerChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  // Member calls are visited as calls, too.
+  void VisitCallExpr(CallExpr *Expr)
+  {
+    ProcessSizeofCallExpr(Expr);
+  }
+
+private:
+  void ProcessSizeofCallExpr(CallExpr *Call)
+  {
+    // Pairs of argument position and pointer expression.  Calls
+    // rarely have more than a few sizeof arguments, so this normally
+    // stays on the stack.
+    typedef llvm::SmallVector<std::pair<unsigned, const Expr *>, 4> ArgList;
+    ArgList SizeofArguments;
+
+    // Find sizeof with pointer arguments.
+    // ??? This shoud generalize to sizeofs of non-array arguments
+    // ??? and we could check if the same expression is used
+    // ??? in a non-reference-taking context in the parameter list.
+    unsigned NumArgs = Call->getNumArgs();
+    for (unsigned i = 0; i < NumArgs; ++i) {
+      const Expr *ArgExpr = ExtractSizeofPointer(Call->getArg(i));
+      if (ArgExpr != NULL) {
+	SizeofArguments.push_back(std::make_pair(i, ArgExpr));
+      }
+    }
+    
+    // Check for exact matches with other arguments.
+    ArgList::const_iterator end = SizeofArguments.end();
+    if (!SizeofArguments.empty()) {
+      for (unsigned i = 0; i < NumArgs; ++i) {
+	for (ArgList::const_iterator p = SizeofArguments.begin();
+	     p != end; ++p) {
+	  if (p->first == i) {
+	    continue;
+	  }
+	  if (EquivalentExpr(Call->getArg(i), p->second)) {
+	    Formatter() << "pointer=" << i << ", sizeof=" << p->first;
+	    Report(Call->getArg(p->first)->getExprLoc(),
+		   "sizeof-pointer", Formatted());
+	    return;
+	  }
+	}
+      }
+    }
+  }
+
+  // Recognizes sizeof(ptr) and sizeof(ptr)-expr.
+  const Expr *ExtractSizeofPointer(const Expr *E)
+  {
+    E = E->IgnoreParenCasts();
+    if (const UnaryExprOrTypeTraitExpr *SE = dyn_cast<UnaryExprOrTypeTraitExpr>(E)) {
+      if (SE->getKind() == UETT_SizeOf && !SE->isArgumentType()) {
+	E = SE->getArgumentExpr()->IgnoreParenCasts();
+	if (E->getType()->isPointerType()) {
+	  return E;
+	}
+      }
+    } else if (const BinaryOperator *O = dyn_cast<BinaryOperator>(E)) {
+      if (O->getOpcode() == BO_Sub) {
+	E = ExtractSizeofPointer(O->getLHS());
+	if (E != NULL) {
+	  return E;
+	}
+      }
+    }
+    return NULL;
+  }
+
+  bool EquivalentExpr(const Expr *L, const Expr *R)
+  {
+    L = L->IgnoreParenCasts();
+    R = R->IgnoreParenCasts();
+    
+    if (const DeclRefExpr *LD = dyn_cast<DeclRefExpr>(L)) {
+      if (const DeclRefExpr *RD = dyn_cast<DeclRefExpr>(R)) {
+	return LD->getDecl() == RD->getDecl();
+      }
+      return false;
+    }
+    if (const UnaryOperator *LO = dyn_cast<UnaryOperator>(L)) {
+      if (const UnaryOperator *RO = dyn_cast<UnaryOperator>(R)) {
+	return LO->getOpcode() == RO->getOpcode()
+	  && EquivalentExpr(LO->getSubExpr(), RO->getSubExpr());
+      }
+      return false;
+    }
+    if (const BinaryOperator *LO = dyn_cast<BinaryOperator>(L)) {
+      if (const BinaryOperator *RO = dyn_cast<BinaryOperator>(R)) {
+	return LO->getOpcode() == RO->getOpcode()
+	  && EquivalentExpr(LO->getLHS(), RO->getLHS())
+	  && EquivalentExpr(LO->getRHS(), RO->getRHS());
+      }
+      return false;
+    }
+    return false;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Pointer arithmetic
+
+class PointerArithChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::UnaryOp | Visits::BinaryOp | Visits::ArraySubscript;
+
+  PointerArithChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitUnaryOperator(UnaryOperator *Expr)
+  {
+    PointerArithProcessUnaryOperator(Expr);
+  }
+
+  void VisitBinaryOperator(BinaryOperator *Expr)
+  {
+    PointerArithProcessBinaryOperator(Expr);
+  }
+
+  void VisitArraySubscriptExpr(ArraySubscriptExpr *Expr)
+  {
+    PointerArithProcessSubscript(Expr);
+  }
+
+private:
+  // TODO: Catch simple subscripts which are statically within array
+  // bounds.
+
+  void PointerArithProcessUnaryOperator(UnaryOperator *Expr)
+  {
+    UnaryOperatorKind Kind = Expr->getOpcode();
+    const char *KindStr;
+    switch (Kind) {
+    case UO_PostInc:
+    case UO_PreInc:
+      KindStr = "inplace-add";
+      break;
+    case UO_PostDec:
+    case UO_PreDec:
+      KindStr = "inplace-sub";
+      break;
+    default:
+      KindStr = NULL;
+    }
+    if (KindStr != NULL && Expr->getType()->isPointerType()) {
+      Report(Expr->getExprLoc(), "pointer-arith", KindStr);
+    }
+  }
+
+  void PointerArithProcessBinaryOperator(BinaryOperator *Expr)
+  {
+    BinaryOperatorKind Kind = Expr->getOpcode();
+    const char *KindStr;
+    switch (Kind) {
+    case BO_Add:
+      KindStr = "add";
+      break;
+    case BO_Sub:
+      KindStr = "sub";
+      break;
+    case BO_AddAssign:
+      KindStr = "inplace-add";
+      break;
+    case BO_SubAssign:
+      KindStr = "inplace-sub";
+      break;
+    default:
+      KindStr = NULL;
+    }
+    if (KindStr != NULL) {
+      unsigned Pointers = 0;
+      if (Expr->getLHS()->getType()->isPointerType()
+	  || Expr->getLHS()->getType()->isArrayType()) {
+	++Pointers;
+      }
+      if (Expr->getRHS()->getType()->isPointerType()
+	  || Expr->getRHS()->getType()->isArrayType()) {
+	++Pointers;
+      }
+      switch (Pointers) {
+      case 1:
+	Report(Expr->getExprLoc(), "pointer-arith", KindStr);
+	break;
+      case 2:
+	Report(Expr->getExprLoc(), "pointer-arith", "diff");
+	break;
+      }
+    }
+  }
+
+  void PointerArithProcessSubscript(ArraySubscriptExpr *E)
+  {
+    Expr *Subscript = NULL;
+    if (E->getLHS()->getType()->isPointerType()
+	|| E->getLHS()->getType()->isArrayType()) {
+      Subscript = E->getRHS();
+    } else if (E->getRHS()->getType()->isPointerType()
+	       || E->getRHS()->getType()->isArrayType()) {
+      Subscript = E->getLHS();
+    }
+    
+    if (Subscript != NULL) {
+      // Most subscripts are literals or plain variables, which do not
+      // need constant evaluation.
+      const Expr *Stripped = Subscript->IgnoreParenImpCasts();
+      if (const IntegerLiteral *Literal = dyn_cast<IntegerLiteral>(Stripped)) {
+	if (Literal->getValue() != 0) {
+	  Report(E->getExprLoc(), "pointer-arith", "subscript");
+	}
+	return;
+      }
+      if (const DeclRefExpr *Ref = dyn_cast<DeclRefExpr>(Stripped)) {
+	const VarDecl *Var = dyn_cast<VarDecl>(Ref->getDecl());
+	if (Var != NULL && !Var->getType().isConstQualified()) {
+	  Report(E->getExprLoc(), "pointer-arith", "subscript");
+	  return;
+	}
+      }
+      llvm::APSInt I;
+      if (!(EvaluateAsInt(Subscript, I) && I == 0)) {
+	Report(E->getExprLoc(), "pointer-arith", "subscript");
+      }
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Array subscripts without bounds checks
+
+class StandardLibrarySubscriptChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::OperatorCall;
+
+  StandardLibrarySubscriptChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitCXXOperatorCallExpr(CXXOperatorCallExpr *Expr)
+  {
+    StandardLibraryProcessSubscript(Expr);
+  }
+
+private:
+  void StandardLibraryProcessSubscript(CXXOperatorCallExpr *Expr)
+  {
+    if (Expr->getOperator() == OO_Subscript) {
+      QualType Type;
+      if (matchTypeAgainstVectorOrString(Expr, Type)) {
+	const char *message =
+	  Type.isConstQualified() ? "operator[] const" : "operator[]";
+	Report(Expr->getExprLoc(), message, Shared.TypeName(Type));
+      }
+    }
+  }
+
+  // Returns true if the unqualified type is an instance of the
+  // standard library templates vector, basic_string or array.
+  bool matchTypeAgainstVectorOrString(CXXOperatorCallExpr *Expr, QualType &Type)
+  {
+    Type = Expr->getArg(0)->getType();
+    switch (Shared.Classify(Type)) {
+    case TypeClass::Vector:
+    case TypeClass::BasicString:
+    case TypeClass::Array:
+      return true;
+    default:
+      return false;
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// alloca
+
+class AllocaChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::Call;
+
+  AllocaChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitCallExpr(CallExpr *Expr)
+  {
+    ProcessAlloca(Expr);
+  }
+
+private:
+  void ProcessAlloca(CallExpr *E)
+  {
+    if (Expr *Callee = E->getCallee()->IgnoreParenCasts()) {
+      if (DeclRefExpr *Ref = dyn_cast<DeclRefExpr>(Callee)) {
+	if (FunctionDecl *FD = dyn_cast<FunctionDecl>(Ref->getDecl())) {
+	  unsigned BuiltinID = FD->getBuiltinID();
+	  if (BuiltinID) {
+	    Builtin::Context Ctx;
+	  }
+	  if (BuiltinID == Builtin::BI__builtin_alloca
+	      || BuiltinID == Builtin::BIalloca) {
+	    Report(E->getExprLoc(), "alloca", "x");
+	  }
+	}
+      }
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Static local variables
+
+class StaticLocalChecker : public Checker {
+public:
+  static const unsigned Kinds = Visits::Var;
+
+  StaticLocalChecker(CheckerContext &C)
+    : Checker(C)
+  {
+  }
+
+  void VisitVarDecl(VarDecl *Decl)
+  {
+    ProcessStaticLocal(Decl);
+  }
+
+private:
+  void ProcessStaticLocal(VarDecl *Decl)
+  {
+    if (Decl->isStaticLocal() && !Decl->getType().isConstQualified()) {
+      Report(Decl->getLocation(), "static-local", Decl->getNameAsString());
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Checker sets
+//
+// The plugin is built with one of these sets, selected with
+// -DHTCONDOR_ANALYSIS_CHECKERS=... (see the Makefile).  analyze runs
+// AllCheckers.
+
+typedef CheckerList<RegisterCommandChecker,
+	CheckerList<SprintfChecker,
+	CheckerList<StrcpyChecker,
+	CheckerList<MyStringChecker,
+	CheckerList<SizeofPointerChecker,
+	CheckerList<PointerArithChecker,
+	CheckerList<StandardLibrarySubscriptChecker,
+	CheckerList<AllocaChecker,
+	CheckerList<StaticLocalChecker> > > > > > > > > AllCheckers;
+
+// Checks for memory safety problems.
+typedef CheckerList<SprintfChecker,
+	CheckerList<StrcpyChecker,
+	CheckerList<SizeofPointerChecker,
+	CheckerList<AllocaChecker,
+	CheckerList<StaticLocalChecker> > > > > SecurityCheckers;
+
+// Uses of HTCondor and standard library interfaces.
+typedef CheckerList<RegisterCommandChecker,
+	CheckerList<MyStringChecker,
+	CheckerList<StandardLibrarySubscriptChecker> > > ApiCheckers;
+
+// Code whose density matters for performance reviews: MyString
+// appends which convert their argument, pointer arithmetic and
+// standard library subscripts in loops.
+typedef CheckerList<MyStringChecker,
+	CheckerList<PointerArithChecker,
+	CheckerList<StandardLibrarySubscriptChecker> > > PerfCheckers;
+
+}
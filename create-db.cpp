@@ -17,17 +17,112 @@
  */
 
 #include "db.hpp"
+#include "db-file.hpp"
 
 #include <stdio.h>
+#include <string.h>
+
+// Adds the columns which were introduced after the first version of
+// the schema to an existing database.  The new tables and indexes
+// are created by main.
+static bool
+UpgradeSchema(Database &DB)
+{
+  if (DB.HasColumn("files", "id") && !DB.HasColumn("files", "analyzed")
+      && !DB.Execute("ALTER TABLE files ADD COLUMN "
+		     "analyzed INTEGER NOT NULL DEFAULT 0;")) {
+    return false;
+  }
+  if (DB.HasColumn("reports", "file")
+      && !DB.HasColumn("reports", "fingerprint")
+      // The old reports_file index only covers the file column.
+      && !DB.Execute("ALTER TABLE reports ADD COLUMN "
+		     "fingerprint INTEGER NOT NULL DEFAULT 0;"
+		     "DROP INDEX IF EXISTS reports_file;")) {
+    return false;
+  }
+  if (DB.HasColumn("reports", "file")
+      && !DB.HasColumn("reports", "occurrences")
+      && !DB.Execute("ALTER TABLE reports ADD COLUMN "
+		     "occurrences INTEGER NOT NULL DEFAULT 1;")) {
+    return false;
+  }
+  // Before identical findings were collapsed in memory, each template
+  // instantiation added its own row, and report removed the
+  // duplicates with SELECT DISTINCT.  Such rows are merged into one,
+  // which counts them in its occurrences column, as the plugin does
+  // now.  Rows written since then are unique, so only old rows are
+  // changed.
+  if (DB.HasColumn("reports", "occurrences")
+      && !DB.Execute
+      ("BEGIN;"
+       "UPDATE reports SET occurrences = "
+       "(SELECT SUM(occurrences) FROM reports AS d "
+       "WHERE d.file = reports.file AND d.line = reports.line "
+       "AND d.column = reports.column AND d.tool = reports.tool "
+       "AND d.message = reports.message) "
+       "WHERE rowid IN (SELECT MIN(rowid) FROM reports "
+       "GROUP BY file, line, column, tool, message HAVING COUNT(*) > 1);"
+       "DELETE FROM reports WHERE rowid NOT IN (SELECT MIN(rowid) "
+       "FROM reports GROUP BY file, line, column, tool, message);"
+       "COMMIT;")) {
+    return false;
+  }
+  return true;
+}
+
+// Fills the new summary table from the latest version of each file.
+static TransactionResult::Enum
+SeedSummary(Database &DB)
+{
+  Statement Counts;
+  TransactionResult::Enum tret = Counts.TxnPrepare
+    (DB, "SELECT files.path, reports.tool, SUM(reports.occurrences) "
+     "FROM files JOIN reports ON reports.file = files.id "
+     "WHERE files.id = (SELECT MAX(id) FROM files AS latest "
+     "WHERE latest.path = files.path) "
+     "GROUP BY files.id, reports.tool");
+  if (tret != TransactionResult::COMMIT) {
+    return tret;
+  }
+  SummaryDelta Delta;
+  int ret;
+  while ((ret = sqlite3_step(Counts.Ptr)) == SQLITE_ROW) {
+    std::string Path((const char *)sqlite3_column_text(Counts.Ptr, 0));
+    std::string Tool((const char *)sqlite3_column_text(Counts.Ptr, 1));
+    Delta[std::make_pair(Tool, SummaryDirectory(DB, Path))]
+      += sqlite3_column_int64(Counts.Ptr, 2);
+  }
+  if (ret != SQLITE_DONE) {
+    return DB.SetTransactionError(sqlite3_sql(Counts.Ptr));
+  }
+  return UpdateSummary(DB, Delta);
+}
 
 int
-main()
+main(int argc, char **argv)
 {
+  bool contentHash = false;
+  if (argc == 2 && strcmp(argv[1], "--content-hash") == 0) {
+    contentHash = true;
+  } else if (argc != 1) {
+    fprintf(stderr, "usage: %s [--content-hash]\n", argv[0]);
+    return 1;
+  }
+
   Database DB;
   if (!DB.Create(Database::FileName)) {
     fprintf(stderr, "could not open database: %s\n", DB.ErrorMessage.c_str());
     return 1;
   }
+  // Databases created before the summary table existed already have
+  // results which need to be counted.
+  bool seedSummary = DB.HasColumn("files", "id")
+    && !DB.HasColumn("summary", "tool");
+  if (!UpgradeSchema(DB)) {
+    fprintf(stderr, "%s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
   if (!DB.Execute
       ("PRAGMA page_size = 4096;"
        "PRAGMA journal_mode = WAL;"
@@ -36,16 +131,93 @@ main()
        "id INTEGER PRIMARY KEY, "
        "path TEXT NOT NULL, "
        "mtime INTEGER NOT NULL, "
-       "size INTEGER NOT NULL);"
+       "size INTEGER NOT NULL, "
+       "analyzed INTEGER NOT NULL DEFAULT 0);"
        "CREATE INDEX IF NOT EXISTS files_path ON files (path);"
+       "CREATE INDEX IF NOT EXISTS files_analyzed ON files (analyzed);"
 
        "CREATE TABLE IF NOT EXISTS reports ("
        "file INTEGER NOT NULL REFERENCES files(id) ON DELETE CASCADE,"
        "line INTEGER NOT NULL,"
        "column INTEGER NOT NULL,"
        "tool TEXT NOT NULL,"
-       "message TEXT NOT NULL);"
-       "CREATE INDEX IF NOT EXISTS reports_file ON reports (file);")) {
+       "message TEXT NOT NULL,"
+       "fingerprint INTEGER NOT NULL DEFAULT 0,"
+       // Number of identical findings collapsed into this row.
+       "occurrences INTEGER NOT NULL DEFAULT 1);"
+       "CREATE INDEX IF NOT EXISTS reports_file "
+       "ON reports (file, fingerprint);"
+       "CREATE INDEX IF NOT EXISTS reports_tool ON reports (tool, file);"
+
+       "CREATE TABLE IF NOT EXISTS snapshots ("
+       "id INTEGER PRIMARY KEY, "
+       "name TEXT NOT NULL UNIQUE, "
+       "created INTEGER NOT NULL, "
+       "last_file INTEGER NOT NULL);"
+
+       // Number of reports in the latest file versions, maintained
+       // by the plugin on commit.
+       "CREATE TABLE IF NOT EXISTS summary ("
+       "tool TEXT NOT NULL, "
+       "directory TEXT NOT NULL, "
+       "count INTEGER NOT NULL, "
+       "PRIMARY KEY (tool, directory));"
+
+       // Copies of the summary table, made when snapshots are tagged.
+       "CREATE TABLE IF NOT EXISTS summary_history ("
+       "snapshot INTEGER NOT NULL "
+       "REFERENCES snapshots(id) ON DELETE CASCADE, "
+       "tool TEXT NOT NULL, "
+       "directory TEXT NOT NULL, "
+       "count INTEGER NOT NULL);"
+       "CREATE INDEX IF NOT EXISTS summary_history_snapshot "
+       "ON summary_history (snapshot);"
+
+       // Analysis time of translation units, used by analyze to
+       // schedule the expensive ones first.
+       "CREATE TABLE IF NOT EXISTS tu_costs ("
+       "path TEXT PRIMARY KEY, "
+       "seconds REAL NOT NULL);"
+
+       // Files read by each translation unit, the main file
+       // included, as of its last commit, with the modification time
+       // and size (and the content hash, see --content-hash) the
+       // files had then.  Used by the stale tool.
+       "CREATE TABLE IF NOT EXISTS includes ("
+       "tu TEXT NOT NULL, "
+       "file TEXT NOT NULL, "
+       "mtime INTEGER NOT NULL, "
+       "size INTEGER NOT NULL, "
+       "hash INTEGER, "
+       "PRIMARY KEY (tu, file));"
+       "CREATE INDEX IF NOT EXISTS includes_file ON includes (file);")) {
+    fprintf(stderr, "%s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
+  if (seedSummary
+      && DB.Transact(std::tr1::bind(SeedSummary, std::tr1::ref(DB)))
+      != TransactionResult::COMMIT) {
+    fprintf(stderr, "%s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
+
+  // Content hashes can be enabled for an existing database.  The
+  // plugin records them if the hash column exists.
+  if (contentHash
+      && !((HasContentHashes(DB)
+	    || DB.Execute("ALTER TABLE files ADD COLUMN hash INTEGER;"))
+	   && DB.Execute
+	   ("CREATE INDEX IF NOT EXISTS files_hash ON files (path, hash);"
+
+	    // Cache for the hashes of the files on disk.  One row per
+	    // inode, valid while mtime and size match.
+	    "CREATE TABLE IF NOT EXISTS file_hashes ("
+	    "device INTEGER NOT NULL, "
+	    "inode INTEGER NOT NULL, "
+	    "mtime INTEGER NOT NULL, "
+	    "size INTEGER NOT NULL, "
+	    "hash INTEGER NOT NULL, "
+	    "PRIMARY KEY (device, inode));"))) {
     fprintf(stderr, "%s\n", DB.ErrorMessage.c_str());
     return 1;
   }
@@ -0,0 +1,672 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Bundle file format.  All integers are unsigned LEB128 varints,
+// except where noted.
+//
+//   magic       8 bytes, "HTCABND2"
+//   strings     count, then length and bytes for each string
+//   files       count, then for each file:
+//                 path (string index), mtime, size, analyzed,
+//                 1 if a content hash follows, 0 otherwise,
+//                 the content hash (8 bytes, little endian),
+//                 number of reports, and for each report:
+//                   line, column, tool (string index),
+//                   message (string index), fingerprint (8 bytes,
+//                   little endian), occurrences
+//   checksum    8 bytes, little endian: HashBytes over all preceding
+//               bytes
+//
+// Tool names and messages repeat a lot, so they are stored once in
+// the string table.
+
+#include "db-bundle.hpp"
+#include "db-file.hpp"
+#include "util.hpp"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <tr1/unordered_map>
+
+namespace {
+  const char Magic[8] = {'H', 'T', 'C', 'A', 'B', 'N', 'D', '2'};
+
+  void
+  AppendVarint(std::string &Target, unsigned long long Value)
+  {
+    while (Value >= 0x80) {
+      Target += char((Value & 0x7F) | 0x80);
+      Value >>= 7;
+    }
+    Target += char(Value);
+  }
+
+  void
+  AppendFixed64(std::string &Target, unsigned long long Value)
+  {
+    for (unsigned i = 0; i < 8; ++i) {
+      Target += char(Value >> (8 * i));
+    }
+  }
+
+  // Assigns indexes to the strings in the order they are first seen.
+  class StringTable {
+    typedef std::tr1::unordered_map<std::string, unsigned long long> Map;
+    Map Indexes;
+  public:
+    std::string Data;		// encoded strings, without the count
+
+    unsigned long long Intern(const char *Str, size_t Length)
+    {
+      std::pair<Map::iterator, bool> Result = Indexes.insert
+	(std::make_pair(std::string(Str, Length), Indexes.size()));
+      if (Result.second) {
+	AppendVarint(Data, Length);
+	Data.append(Str, Length);
+      }
+      return Result.first->second;
+    }
+
+    unsigned long long Intern(sqlite3_stmt *Stmt, int Column)
+    {
+      return Intern((const char *)sqlite3_column_text(Stmt, Column),
+		    sqlite3_column_bytes(Stmt, Column));
+    }
+
+    unsigned long long size() const
+    {
+      return Indexes.size();
+    }
+  };
+
+  TransactionResult::Enum
+  RunExport(Database &DB, bool Hashes, StringTable &Strings,
+	    std::string &Body, BundleStatistics &Stats)
+  {
+    Strings = StringTable();
+    Body.clear();
+    Stats = BundleStatistics();
+
+    Statement Files, Reports;
+    TransactionResult::Enum tret = Files.TxnPrepare
+      (DB, Hashes
+       ? "SELECT id, path, mtime, size, analyzed, hash FROM files "
+       "WHERE id IN (SELECT MAX(id) FROM files GROUP BY path) "
+       "ORDER BY id"
+       : "SELECT id, path, mtime, size, analyzed, NULL FROM files "
+       "WHERE id IN (SELECT MAX(id) FROM files GROUP BY path) "
+       "ORDER BY id");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    tret = Reports.TxnPrepare
+      (DB, "SELECT line, column, tool, message, fingerprint, occurrences "
+       "FROM reports WHERE file = ? ORDER BY rowid");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+
+    // The file count is not known in advance, so the file records
+    // are collected first.
+    std::string Records;
+    std::string FileReports;
+    int ret;
+    while ((ret = sqlite3_step(Files.Ptr)) == SQLITE_ROW) {
+      ++Stats.Files;
+      AppendVarint(Records, Strings.Intern(Files.Ptr, 1));
+      AppendVarint(Records, sqlite3_column_int64(Files.Ptr, 2));
+      AppendVarint(Records, sqlite3_column_int64(Files.Ptr, 3));
+      AppendVarint(Records, sqlite3_column_int64(Files.Ptr, 4));
+      if (sqlite3_column_type(Files.Ptr, 5) == SQLITE_NULL) {
+	AppendVarint(Records, 0);
+      } else {
+	AppendVarint(Records, 1);
+	AppendFixed64(Records, sqlite3_column_int64(Files.Ptr, 5));
+      }
+
+      sqlite3_reset(Reports.Ptr);
+      sqlite3_bind_int64(Reports.Ptr, 1, sqlite3_column_int64(Files.Ptr, 0));
+      FileReports.clear();
+      unsigned long long Count = 0;
+      while ((ret = sqlite3_step(Reports.Ptr)) == SQLITE_ROW) {
+	++Count;
+	AppendVarint(FileReports, sqlite3_column_int64(Reports.Ptr, 0));
+	AppendVarint(FileReports, sqlite3_column_int64(Reports.Ptr, 1));
+	AppendVarint(FileReports, Strings.Intern(Reports.Ptr, 2));
+	AppendVarint(FileReports, Strings.Intern(Reports.Ptr, 3));
+	AppendFixed64(FileReports, sqlite3_column_int64(Reports.Ptr, 4));
+	AppendVarint(FileReports, sqlite3_column_int64(Reports.Ptr, 5));
+      }
+      if (ret != SQLITE_DONE) {
+	return DB.SetTransactionError(sqlite3_sql(Reports.Ptr));
+      }
+      Stats.Reports += Count;
+      AppendVarint(Records, Count);
+      Records += FileReports;
+    }
+    if (ret != SQLITE_DONE) {
+      return DB.SetTransactionError(sqlite3_sql(Files.Ptr));
+    }
+    AppendVarint(Body, Stats.Files);
+    Body += Records;
+    // Nothing has been written, so the transaction can end with a
+    // commit.
+    return TransactionResult::COMMIT;
+  }
+
+  // Decodes a bundle held in memory.  After a decoding error, all
+  // functions return zero, and Failed is set.
+  class BundleReader {
+    const unsigned char *Ptr;
+    const unsigned char *End;
+  public:
+    bool Failed;
+
+    BundleReader(const std::string &Data)
+      : Ptr((const unsigned char *)Data.data()), End(Ptr + Data.size()),
+	Failed(false)
+    {
+    }
+
+    unsigned long long Varint()
+    {
+      unsigned long long Value = 0;
+      for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+	if (Ptr == End) {
+	  break;
+	}
+	unsigned char Byte = *Ptr++;
+	Value |= (unsigned long long)(Byte & 0x7F) << Shift;
+	if ((Byte & 0x80) == 0) {
+	  return Value;
+	}
+      }
+      Failed = true;
+      Ptr = End;
+      return 0;
+    }
+
+    unsigned long long Fixed64()
+    {
+      if (End - Ptr < 8) {
+	Failed = true;
+	Ptr = End;
+	return 0;
+      }
+      unsigned long long Value = 0;
+      for (unsigned i = 0; i < 8; ++i) {
+	Value |= (unsigned long long)Ptr[i] << (8 * i);
+      }
+      Ptr += 8;
+      return Value;
+    }
+
+    // Returns a pointer to the next Length bytes and skips them.
+    const char *Bytes(unsigned long long Length)
+    {
+      if ((unsigned long long)(End - Ptr) < Length) {
+	Failed = true;
+	Ptr = End;
+	return NULL;
+      }
+      const char *Result = (const char *)Ptr;
+      Ptr += Length;
+      return Result;
+    }
+
+    bool AtEnd() const
+    {
+      return Ptr == End;
+    }
+  };
+
+  // A string in the bundle buffer.
+  struct BundleString {
+    const char *Data;
+    int Length;
+  };
+
+  bool
+  ReadFile(const char *Path, std::string &Data, std::string &ErrorMessage)
+  {
+    FILE *in = fopen(Path, "rb");
+    if (in == NULL) {
+      ErrorMessage.clear();
+      AppendErrorString(ErrorMessage, errno);
+      return false;
+    }
+    Data.clear();
+    char Buffer[65536];
+    size_t Count;
+    while ((Count = fread(Buffer, 1, sizeof(Buffer), in)) > 0) {
+      Data.append(Buffer, Count);
+    }
+    bool Result = !ferror(in);
+    if (!Result) {
+      ErrorMessage.clear();
+      AppendErrorString(ErrorMessage, errno);
+    }
+    fclose(in);
+    return Result;
+  }
+
+  // Checks the magic number and the checksum, and removes both from
+  // Data.
+  bool
+  Unwrap(std::string &Data, std::string &ErrorMessage)
+  {
+    if (Data.size() < sizeof(Magic) + 8
+	|| memcmp(Data.data(), Magic, sizeof(Magic) - 1) != 0) {
+      ErrorMessage = "not a bundle file";
+      return false;
+    }
+    if (Data[sizeof(Magic) - 1] != Magic[sizeof(Magic) - 1]) {
+      ErrorMessage = "unsupported bundle file version";
+      return false;
+    }
+    size_t Payload = Data.size() - 8;
+    BundleReader Trailer(Data.substr(Payload));
+    if (Trailer.Fixed64() != HashBytes(HashInitial, Data.data(), Payload)) {
+      ErrorMessage = "checksum mismatch";
+      return false;
+    }
+    Data.resize(Payload);
+    Data.erase(0, sizeof(Magic));
+    return true;
+  }
+
+  std::string
+  Remap(const PathRemapList &Remaps, const char *Path, int Length)
+  {
+    std::string Result(Path, Length);
+    for (PathRemapList::const_iterator p = Remaps.begin(),
+	   end = Remaps.end(); p != end; ++p) {
+      if (Result.compare(0, p->first.size(), p->first) == 0) {
+	Result.replace(0, p->first.size(), p->second);
+	break;
+      }
+    }
+    return Result;
+  }
+
+  TransactionResult::Enum
+  ExecuteStatement(Database &DB, const char *SQL)
+  {
+    Statement Stmt;
+    TransactionResult::Enum tret = Stmt.TxnPrepare(DB, SQL);
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    if (sqlite3_step(Stmt.Ptr) != SQLITE_DONE) {
+      return DB.SetTransactionError(SQL);
+    }
+    return TransactionResult::COMMIT;
+  }
+
+  // Drops the indexes on the reports table and stores their
+  // definitions in Indexes.  Building an index from scratch is much
+  // faster than updating it for each inserted row.
+  TransactionResult::Enum
+  DropReportIndexes(Database &DB, std::vector<std::string> &Indexes)
+  {
+    Indexes.clear();
+    std::vector<std::string> Names;
+    Statement Query;
+    TransactionResult::Enum tret = Query.TxnPrepare
+      (DB, "SELECT name, sql FROM sqlite_master WHERE type = 'index' "
+       "AND tbl_name = 'reports' AND sql IS NOT NULL");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    int ret;
+    while ((ret = sqlite3_step(Query.Ptr)) == SQLITE_ROW) {
+      Names.push_back((const char *)sqlite3_column_text(Query.Ptr, 0));
+      Indexes.push_back((const char *)sqlite3_column_text(Query.Ptr, 1));
+    }
+    if (ret != SQLITE_DONE) {
+      return DB.SetTransactionError(sqlite3_sql(Query.Ptr));
+    }
+    for (std::vector<std::string>::const_iterator p = Names.begin(),
+	   end = Names.end(); p != end; ++p) {
+      char *SQL = sqlite3_mprintf("DROP INDEX \"%w\"", p->c_str());
+      tret = ExecuteStatement(DB, SQL);
+      sqlite3_free(SQL);
+      if (tret != TransactionResult::COMMIT) {
+	return tret;
+      }
+    }
+    return TransactionResult::COMMIT;
+  }
+
+  // Report records, as stored in the bundle.
+  struct BundleReport {
+    unsigned long long Line;
+    unsigned long long Column;
+    unsigned long long Tool;	// string index
+    unsigned long long Message;	// string index
+    unsigned long long Fingerprint;
+    unsigned long long Occurrences;
+
+    void Read(BundleReader &Reader, size_t StringCount)
+    {
+      Line = Reader.Varint();
+      Column = Reader.Varint();
+      Tool = Reader.Varint();
+      Message = Reader.Varint();
+      Fingerprint = Reader.Fixed64();
+      Occurrences = Reader.Varint();
+      if (Tool >= StringCount || Message >= StringCount) {
+	Reader.Failed = true;
+      }
+    }
+  };
+
+  TransactionResult::Enum
+  RunImport(Database &DB, bool Hashes, const std::string &Data,
+	    const PathRemapList &Remaps, BundleStatistics &Stats)
+  {
+    Stats = BundleStatistics();
+    Statement Exists, Latest, Counts, InsertFile, InsertReport;
+    TransactionResult::Enum tret = Exists.TxnPrepare
+      (DB, "SELECT 1 FROM files WHERE path = ? AND mtime = ? AND size = ? "
+       "LIMIT 1");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    tret = Latest.TxnPrepare
+      (DB, "SELECT id FROM files WHERE path = ? ORDER BY id DESC LIMIT 1");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    tret = Counts.TxnPrepare
+      (DB, "SELECT tool, SUM(occurrences) FROM reports "
+       "WHERE file = ? GROUP BY tool");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    tret = InsertFile.TxnPrepare
+      (DB, Hashes
+       ? "INSERT INTO files (path, mtime, size, analyzed, hash) "
+       "VALUES (?, ?, ?, ?, ?)"
+       : "INSERT INTO files (path, mtime, size, analyzed) "
+       "VALUES (?, ?, ?, ?)");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+
+    // The strings are bound directly from the buffer.
+    BundleReader Reader(Data);
+    unsigned long long StringCount = Reader.Varint();
+    if (StringCount > Data.size()) {
+      // Each string takes at least one byte.
+      DB.ErrorMessage = "corrupt bundle";
+      return TransactionResult::ERROR;
+    }
+    std::vector<BundleString> Strings(StringCount);
+    for (size_t i = 0; i < Strings.size() && !Reader.Failed; ++i) {
+      unsigned long long Length = Reader.Varint();
+      Strings[i].Data = Reader.Bytes(Length);
+      Strings[i].Length = Length;
+    }
+    unsigned long long FileCount = Reader.Varint();
+
+    // First pass: add the file versions which are not present yet,
+    // and subtract the versions they supersede from the summary.
+    // This needs the indexes on the reports table.  FileIDs receives
+    // the new file IDs, or zero for duplicates, and Directories the
+    // summary directories.
+    SummaryDelta Delta;
+    unsigned long long NewReports = 0;
+    std::vector<sqlite3_int64> FileIDs;
+    std::vector<std::string> Directories;
+    const BundleReader FilesStart(Reader);
+    BundleReport R;
+    for (unsigned long long i = 0; i < FileCount && !Reader.Failed; ++i) {
+      unsigned long long PathIndex = Reader.Varint();
+      sqlite3_int64 Mtime = Reader.Varint();
+      sqlite3_int64 Size = Reader.Varint();
+      sqlite3_int64 Analyzed = Reader.Varint();
+      bool HasHash = Reader.Varint() != 0;
+      sqlite3_int64 Hash = HasHash ? Reader.Fixed64() : 0;
+      unsigned long long ReportCount = Reader.Varint();
+      for (unsigned long long j = 0; j < ReportCount && !Reader.Failed; ++j) {
+	R.Read(Reader, Strings.size());
+      }
+      if (PathIndex >= Strings.size()) {
+	Reader.Failed = true;
+      }
+      if (Reader.Failed) {
+	break;
+      }
+      std::string Path(Remap(Remaps, Strings[PathIndex].Data,
+			     Strings[PathIndex].Length));
+      ++Stats.Files;
+
+      sqlite3_reset(Exists.Ptr);
+      sqlite3_bind_text(Exists.Ptr, 1, Path.data(), Path.size(),
+			SQLITE_STATIC);
+      sqlite3_bind_int64(Exists.Ptr, 2, Mtime);
+      sqlite3_bind_int64(Exists.Ptr, 3, Size);
+      int ret = sqlite3_step(Exists.Ptr);
+      if (ret != SQLITE_ROW && ret != SQLITE_DONE) {
+	return DB.SetTransactionError(sqlite3_sql(Exists.Ptr));
+      }
+      sqlite3_reset(Exists.Ptr);
+      if (ret == SQLITE_ROW) {
+	++Stats.Duplicates;
+	FileIDs.push_back(0);
+	Directories.push_back(std::string());
+	continue;
+      }
+
+      std::string Directory(SummaryDirectory(DB, Path));
+      sqlite3_reset(Latest.Ptr);
+      sqlite3_bind_text(Latest.Ptr, 1, Path.data(), Path.size(),
+			SQLITE_STATIC);
+      ret = sqlite3_step(Latest.Ptr);
+      if (ret == SQLITE_ROW) {
+	sqlite3_reset(Counts.Ptr);
+	sqlite3_bind_int64(Counts.Ptr, 1, sqlite3_column_int64(Latest.Ptr, 0));
+	while ((ret = sqlite3_step(Counts.Ptr)) == SQLITE_ROW) {
+	  std::string Tool((const char *)sqlite3_column_text(Counts.Ptr, 0));
+	  Delta[std::make_pair(Tool, Directory)]
+	    -= sqlite3_column_int64(Counts.Ptr, 1);
+	}
+	if (ret != SQLITE_DONE) {
+	  return DB.SetTransactionError(sqlite3_sql(Counts.Ptr));
+	}
+      } else if (ret != SQLITE_DONE) {
+	return DB.SetTransactionError(sqlite3_sql(Latest.Ptr));
+      }
+      sqlite3_reset(Latest.Ptr);
+
+      sqlite3_reset(InsertFile.Ptr);
+      sqlite3_bind_text(InsertFile.Ptr, 1, Path.data(), Path.size(),
+			SQLITE_STATIC);
+      sqlite3_bind_int64(InsertFile.Ptr, 2, Mtime);
+      sqlite3_bind_int64(InsertFile.Ptr, 3, Size);
+      sqlite3_bind_int64(InsertFile.Ptr, 4, Analyzed);
+      if (Hashes) {
+	if (HasHash) {
+	  sqlite3_bind_int64(InsertFile.Ptr, 5, Hash);
+	} else {
+	  sqlite3_bind_null(InsertFile.Ptr, 5);
+	}
+      }
+      if (sqlite3_step(InsertFile.Ptr) != SQLITE_DONE) {
+	return DB.SetTransactionError(sqlite3_sql(InsertFile.Ptr));
+      }
+      FileIDs.push_back(sqlite3_last_insert_rowid(DB.Ptr));
+      Directories.push_back(Directory);
+      NewReports += ReportCount;
+    }
+    if (Reader.Failed || !Reader.AtEnd()) {
+      DB.ErrorMessage = "corrupt bundle";
+      return TransactionResult::ERROR;
+    }
+
+    // If the import at least doubles the size of the reports table,
+    // the indexes are dropped and built again after the inserts.
+    Statement Existing;
+    tret = Existing.TxnPrepare
+      (DB, "SELECT IFNULL(MAX(rowid), 0) FROM reports");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    if (sqlite3_step(Existing.Ptr) != SQLITE_ROW) {
+      return DB.SetTransactionError(sqlite3_sql(Existing.Ptr));
+    }
+    unsigned long long ExistingReports = sqlite3_column_int64(Existing.Ptr, 0);
+    Existing.Close();
+    std::vector<std::string> Indexes;
+    if (NewReports > 0 && NewReports >= ExistingReports) {
+      tret = DropReportIndexes(DB, Indexes);
+      if (tret != TransactionResult::COMMIT) {
+	return tret;
+      }
+    }
+
+    // Second pass: add the reports of the new file versions.
+    tret = InsertReport.TxnPrepare
+      (DB, "INSERT INTO reports "
+       "(file, line, column, tool, message, fingerprint, occurrences) "
+       "VALUES (?, ?, ?, ?, ?, ?, ?)");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    Reader = FilesStart;
+    std::vector<long long> ToolCounts(Strings.size());
+    for (size_t i = 0; i < FileIDs.size(); ++i) {
+      for (unsigned j = 0; j < 4; ++j) {
+	// Path index, mtime, size, analyzed.
+	Reader.Varint();
+      }
+      if (Reader.Varint() != 0) {
+	Reader.Fixed64();
+      }
+      unsigned long long ReportCount = Reader.Varint();
+      if (FileIDs[i] != 0) {
+	sqlite3_bind_int64(InsertReport.Ptr, 1, FileIDs[i]);
+      }
+      std::vector<unsigned long long> Tools;
+      for (unsigned long long j = 0; j < ReportCount; ++j) {
+	R.Read(Reader, Strings.size());
+	if (FileIDs[i] == 0) {
+	  continue;
+	}
+	sqlite3_reset(InsertReport.Ptr);
+	sqlite3_bind_int64(InsertReport.Ptr, 2, R.Line);
+	sqlite3_bind_int64(InsertReport.Ptr, 3, R.Column);
+	sqlite3_bind_text(InsertReport.Ptr, 4, Strings[R.Tool].Data,
+			  Strings[R.Tool].Length, SQLITE_STATIC);
+	sqlite3_bind_text(InsertReport.Ptr, 5, Strings[R.Message].Data,
+			  Strings[R.Message].Length, SQLITE_STATIC);
+	sqlite3_bind_int64(InsertReport.Ptr, 6, R.Fingerprint);
+	sqlite3_bind_int64(InsertReport.Ptr, 7, R.Occurrences);
+	if (sqlite3_step(InsertReport.Ptr) != SQLITE_DONE) {
+	  return DB.SetTransactionError(sqlite3_sql(InsertReport.Ptr));
+	}
+	if (ToolCounts[R.Tool] == 0) {
+	  Tools.push_back(R.Tool);
+	}
+	ToolCounts[R.Tool] += R.Occurrences;
+	++Stats.Reports;
+      }
+      // Counting per string index avoids building a summary key for
+      // each report.
+      for (std::vector<unsigned long long>::const_iterator
+	     p = Tools.begin(), end = Tools.end(); p != end; ++p) {
+	Delta[std::make_pair(std::string(Strings[*p].Data,
+					 Strings[*p].Length),
+			     Directories[i])] += ToolCounts[*p];
+	ToolCounts[*p] = 0;
+      }
+    }
+
+    for (std::vector<std::string>::const_iterator p = Indexes.begin(),
+	   end = Indexes.end(); p != end; ++p) {
+      tret = ExecuteStatement(DB, p->c_str());
+      if (tret != TransactionResult::COMMIT) {
+	return tret;
+      }
+    }
+    return UpdateSummary(DB, Delta);
+  }
+}
+
+bool
+ExportBundle(Database &DB, const char *Path, BundleStatistics &Stats)
+{
+  StringTable Strings;
+  std::string Body;
+  if (DB.Transact(std::tr1::bind(RunExport, std::tr1::ref(DB),
+				 HasContentHashes(DB),
+				 std::tr1::ref(Strings), std::tr1::ref(Body),
+				 std::tr1::ref(Stats)))
+      != TransactionResult::COMMIT) {
+    return false;
+  }
+
+  std::string Data(Magic, sizeof(Magic));
+  AppendVarint(Data, Strings.size());
+  Data += Strings.Data;
+  Strings = StringTable();
+  Data += Body;
+  Body.clear();
+  AppendFixed64(Data, HashBytes(HashInitial, Data.data(), Data.size()));
+
+  FILE *out = fopen(Path, "wb");
+  if (out == NULL) {
+    DB.ErrorMessage.clear();
+    AppendErrorString(DB.ErrorMessage, errno);
+    return false;
+  }
+  bool Result = fwrite(Data.data(), 1, Data.size(), out) == Data.size();
+  if (fclose(out) != 0) {
+    Result = false;
+  }
+  if (!Result) {
+    DB.ErrorMessage.clear();
+    AppendErrorString(DB.ErrorMessage, errno);
+  }
+  return Result;
+}
+
+bool
+ImportBundle(Database &DB, const char *Path, const PathRemapList &Remaps,
+	     BundleStatistics &Stats)
+{
+  std::string Data;
+  if (!(ReadFile(Path, Data, DB.ErrorMessage)
+	&& Unwrap(Data, DB.ErrorMessage))) {
+    return false;
+  }
+  // The report indexes grow by the size of the bundle within one
+  // transaction.  With the default page cache of 2 MB, most index
+  // updates would spill to the write-ahead log.  The cache is only
+  // allocated as needed.
+  if (!DB.Execute("PRAGMA cache_size = -262144")) {
+    return false;
+  }
+  return DB.Transact(std::tr1::bind(RunImport, std::tr1::ref(DB),
+				    HasContentHashes(DB),
+				    std::tr1::cref(Data),
+				    std::tr1::cref(Remaps),
+				    std::tr1::ref(Stats)))
+    == TransactionResult::COMMIT;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class Database;
+
+// A bundle carries the latest version of each file in a database,
+// together with its reports, to another database.  This is used to
+// combine the results of builds on several machines.
+
+// Path prefix substitutions applied on import.  The first pair whose
+// first element is a prefix of the path applies.
+typedef std::vector<std::pair<std::string, std::string> > PathRemapList;
+
+struct BundleStatistics {
+  unsigned long long Files;	// file versions in the bundle
+  unsigned long long Duplicates; // of which were already present
+  unsigned long long Reports;	// reports written
+
+  BundleStatistics() : Files(0), Duplicates(0), Reports(0) { }
+};
+
+// Writes the latest file versions in the database and their reports
+// to the bundle file at Path.  The content hashes of the files are
+// included if the database records them (see HasContentHashes).
+bool ExportBundle(Database &, const char *Path, BundleStatistics &);
+
+// Adds the file versions in the bundle at Path, with their reports,
+// to the database, in a single transaction.  File versions (path,
+// mtime and size, after remapping the path) which are already in
+// the database are skipped.  The summary table is updated.  Content
+// hashes are stored if the database has the hash column.
+bool ImportBundle(Database &, const char *Path, const PathRemapList &,
+		  BundleStatistics &);
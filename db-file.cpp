@@ -22,15 +22,18 @@
 
 #include <map>
 #include <vector>
+#include <tr1/unordered_map>
 
 #include <limits.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 
 //////////////////////////////////////////////////////////////////////
 // FileIdentification
 
 FileIdentification::FileIdentification(const char *path)
-  : Mtime(0), Size(0)
+  : Mtime(0), Size(0), Device(0), Inode(0)
 {
   if (ResolvePath(path, Path)) {
     struct stat st;
@@ -38,12 +41,169 @@ FileIdentification::FileIdentification(const char *path)
     if (ret == 0) {
       Mtime = st.st_mtime;
       Size = st.st_size;
+      Device = st.st_dev;
+      Inode = st.st_ino;
     } else {
       Path.clear();
     }
   }
 }
 
+//////////////////////////////////////////////////////////////////////
+// Content hashes
+
+bool
+HasContentHashes(Database &DB)
+{
+  return DB.HasColumn("files", "hash");
+}
+
+bool
+ContentHash(Database &DB, const FileIdentification &FI,
+	    unsigned long long &Hash, bool &Cached)
+{
+  // A failed lookup is treated like a missing entry.
+  Statement Lookup;
+  if (Lookup.Prepare(DB, "SELECT hash FROM file_hashes "
+		     "WHERE device = ? AND inode = ? AND mtime = ? "
+		     "AND size = ?")) {
+    sqlite3_bind_int64(Lookup.Ptr, 1, FI.Device);
+    sqlite3_bind_int64(Lookup.Ptr, 2, FI.Inode);
+    sqlite3_bind_int64(Lookup.Ptr, 3, FI.Mtime);
+    sqlite3_bind_int64(Lookup.Ptr, 4, FI.Size);
+    if (sqlite3_step(Lookup.Ptr) == SQLITE_ROW) {
+      Hash = sqlite3_column_int64(Lookup.Ptr, 0);
+      Cached = true;
+      return true;
+    }
+  }
+  Cached = false;
+  return HashFileContents(FI.Path.c_str(), Hash);
+}
+
+TransactionResult::Enum
+CacheContentHash(Database &DB, const FileIdentification &FI,
+		 unsigned long long Hash)
+{
+  // One row per inode, so that the table does not grow with each
+  // modification of a file.
+  Statement Insert;
+  TransactionResult::Enum tret = Insert.TxnPrepare
+    (DB, "INSERT OR REPLACE INTO file_hashes "
+     "(device, inode, mtime, size, hash) VALUES (?, ?, ?, ?, ?)");
+  if (tret != TransactionResult::COMMIT) {
+    return tret;
+  }
+  sqlite3_bind_int64(Insert.Ptr, 1, FI.Device);
+  sqlite3_bind_int64(Insert.Ptr, 2, FI.Inode);
+  sqlite3_bind_int64(Insert.Ptr, 3, FI.Mtime);
+  sqlite3_bind_int64(Insert.Ptr, 4, FI.Size);
+  sqlite3_bind_int64(Insert.Ptr, 5, Hash);
+  if (sqlite3_step(Insert.Ptr) != SQLITE_DONE) {
+    return DB.SetTransactionError(sqlite3_sql(Insert.Ptr));
+  }
+  return TransactionResult::COMMIT;
+}
+
+static TransactionResult::Enum
+RunStoreContentHashes(Database &DB, const ContentHashList &Hashes)
+{
+  for (ContentHashList::const_iterator p = Hashes.begin(),
+	 end = Hashes.end(); p != end; ++p) {
+    TransactionResult::Enum tret = CacheContentHash(DB, p->first, p->second);
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+  }
+  return TransactionResult::COMMIT;
+}
+
+bool
+StoreContentHashes(Database &DB, const ContentHashList &Hashes)
+{
+  if (Hashes.empty()) {
+    return true;
+  }
+  Database Writer;
+  if (!(Writer.Open(sqlite3_db_filename(DB.Ptr, "main"))
+	&& Writer.Transact(std::tr1::bind(RunStoreContentHashes,
+					  std::tr1::ref(Writer),
+					  std::tr1::cref(Hashes)))
+	== TransactionResult::COMMIT)) {
+    DB.ErrorMessage = Writer.ErrorMessage;
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Summary table
+
+std::string
+SummaryDirectory(Database &DB, const std::string &Path)
+{
+  // Directory containing the database, with a trailing slash.
+  std::string Root(sqlite3_db_filename(DB.Ptr, "main"));
+  Root.resize(Root.rfind('/') + 1);
+  std::string::size_type Start;
+  if (Path.compare(0, Root.size(), Root) == 0) {
+    Start = Root.size();
+  } else {
+    // Keep the leading slash, as in "/usr".
+    Start = 0;
+  }
+  std::string::size_type Slash = Path.find('/', Start == 0 ? 1 : Start);
+  if (Slash == std::string::npos) {
+    // A file in the top-level directory itself.
+    return Start == 0 ? "/" : ".";
+  }
+  return Path.substr(Start, Slash - Start);
+}
+
+TransactionResult::Enum
+UpdateSummary(Database &DB, const SummaryDelta &Delta)
+{
+  Statement Insert, Update;
+  TransactionResult::Enum tret = Insert.TxnPrepare
+    (DB, "INSERT OR IGNORE INTO summary (tool, directory, count) "
+     "VALUES (?, ?, 0)");
+  if (tret != TransactionResult::COMMIT) {
+    return tret;
+  }
+  tret = Update.TxnPrepare
+    (DB, "UPDATE summary SET count = count + ? "
+     "WHERE tool = ? AND directory = ?");
+  if (tret != TransactionResult::COMMIT) {
+    return tret;
+  }
+  for (SummaryDelta::const_iterator p = Delta.begin(), end = Delta.end();
+       p != end; ++p) {
+    if (p->second == 0) {
+      continue;
+    }
+    const std::string &Tool(p->first.first);
+    const std::string &Directory(p->first.second);
+    sqlite3_reset(Insert.Ptr);
+    sqlite3_bind_text(Insert.Ptr, 1, Tool.data(), Tool.size(),
+		      SQLITE_TRANSIENT);
+    sqlite3_bind_text(Insert.Ptr, 2, Directory.data(), Directory.size(),
+		      SQLITE_TRANSIENT);
+    if (sqlite3_step(Insert.Ptr) != SQLITE_DONE) {
+      return DB.SetTransactionError(sqlite3_sql(Insert.Ptr));
+    }
+    sqlite3_reset(Update.Ptr);
+    sqlite3_bind_int64(Update.Ptr, 1, p->second);
+    sqlite3_bind_text(Update.Ptr, 2, Tool.data(), Tool.size(),
+		      SQLITE_TRANSIENT);
+    sqlite3_bind_text(Update.Ptr, 3, Directory.data(), Directory.size(),
+		      SQLITE_TRANSIENT);
+    if (sqlite3_step(Update.Ptr) != SQLITE_DONE) {
+      return DB.SetTransactionError(sqlite3_sql(Update.Ptr));
+    }
+  }
+  return TransactionResult::COMMIT;
+}
+
 //////////////////////////////////////////////////////////////////////
 // FileIdentificationDatabase
 
@@ -55,9 +215,20 @@ struct FileIdentificationDatabase::Impl {
   struct FileTableEntry {
     FileIdentification Ident;
     FileID ID;
-
-    FileTableEntry(const std::string &Path)
-      : Ident(Path.c_str()), ID(0)
+    std::string Directory;	// for the summary table
+    unsigned Key;		// identifies the file in the staging table
+    // Number of staged findings by tool, for the summary table.
+    std::map<std::string, long long> StagedCounts;
+
+    // Content hash, if the database records them (see HashFile).
+    bool Hashed;		// HashFile was called
+    bool HashValid;		// the file could be read
+    bool HashCached;		// Hash came from file_hashes
+    unsigned long long Hash;
+
+    FileTableEntry(const std::string &Path, unsigned key)
+      : Ident(Path.c_str()), ID(0), Key(key),
+	Hashed(false), HashValid(false), HashCached(false), Hash(0)
     {
     }
   };
@@ -67,39 +238,187 @@ struct FileIdentificationDatabase::Impl {
   typedef std::vector<std::string> TouchedFilesList;
   TouchedFilesList TouchedFiles;
 
+  // Canonical path of the main file (see SetMainFile).
+  std::string MainFile;
+  // Entries for TouchedFiles, identified and hashed before the commit
+  // transaction (see IdentifyTouchedFiles).  Touched is keyed by the
+  // paths in TouchedFiles, Included by canonical path, for the
+  // includes table.  The entries are only added to FTable if the
+  // files are in the database (see MarkAsProcessed).
+  FTableMap Touched;
+  FTableMap Included;
+
   struct Report {
     std::tr1::shared_ptr<FileTableEntry> FI;
     unsigned Line;
     unsigned Column;
     std::string Tool;
     std::string Message;
+    unsigned long long Fingerprint;
+    unsigned Occurrences;
 
     Report(std::tr1::shared_ptr<FileTableEntry> fi,
 	   unsigned line,
 	   unsigned column,
 	   const std::string& tool,
-	   const std::string& message)
+	   const std::string& message,
+	   unsigned long long fingerprint)
       : FI(fi),
 	Line(line),
 	Column(column),
 	Tool(tool),
-	Message(message)
+	Message(message),
+	Fingerprint(fingerprint),
+	Occurrences(1)
     {
     }
+
+    bool SameFinding(const FileTableEntry *fi, unsigned line,
+		     unsigned column, const char *tool,
+		     const std::string &message) const
+    {
+      return FI.get() == fi && Line == line && Column == column
+	&& Tool == tool && Message == message;
+    }
   };
 
   std::vector<Report> Reports;
 
+  // Positions in Reports, indexed by a hash of the file, location,
+  // tool and message.  Template instantiations and macro expansions
+  // produce many identical findings, which are counted instead of
+  // being stored again.
+  typedef std::tr1::unordered_multimap<unsigned long long, size_t>
+    ReportIndexMap;
+  ReportIndexMap ReportIndex;
+
+  // Once Reports holds ChunkSize reports, they are moved to the
+  // staging table in the temporary database of the connection
+  // (FlushChunk), which does not lock the database file.  Commit then
+  // publishes the staged reports.  This bounds the memory used for
+  // very large translation units.  It does not shorten the write
+  // transaction, which still copies every staged row into the reports
+  // table; only the summary counts and the clean-up of the staging
+  // table happen outside it.  Translation units with fewer reports
+  // are committed directly from memory.  Staging requires a
+  // connection of our own (see the lazy constructor), because the
+  // staging table is shared by all users of the connection.
+  static const size_t ChunkSize = 16384;
+  bool Staged;			// reports have been flushed to staging
+  unsigned NextKey;		// for FileTableEntry::Key
+
+  // Base directory for relative paths, with a trailing slash, or
+  // empty for the current directory.
+  std::string Directory;
+
+  // Returns Path, interpreted relative to Directory.
+  std::string Absolute(const char *Path) const
+  {
+    if (Directory.empty() || Path[0] == '/') {
+      return Path;
+    }
+    return Directory + Path;
+  }
+
+  // Set if the database is to be opened at the first commit.
+  bool Lazy;
+  std::string LazyPath;		// empty for Database::Locate
+
+  // Set if the connection is not shared with other objects.
+  bool PrivateConnection;
+
+  // Message of the last error, returned by ErrorMessage.  Errors
+  // found while recording reports are kept here instead of in
+  // DB->ErrorMessage, because the connection may be shared with
+  // threads which commit at the same time (see analyze).  Commit
+  // copies the message of the connection here.
+  std::string ErrorMessage;
+
+  // Set at the first commit if the database has the hash column.
+  bool HashesChecked;
+  bool UseHashes;
+
+  unsigned CommitRetries;	// see Retries
+
   Impl(std::tr1::shared_ptr<Database> db)
-    : DB(db)
+    : DB(db), Staged(false), NextKey(0), Lazy(false),
+      PrivateConnection(false), HashesChecked(false), UseHashes(false),
+      CommitRetries(0)
   {
   }
 
+  void HashFile(FileTableEntry &FTE)
+  {
+    if (!FTE.Hashed) {
+      FTE.HashValid = ContentHash(*DB, FTE.Ident, FTE.Hash, FTE.HashCached);
+      FTE.Hashed = true;
+    }
+  }
+
+  // Hashes the files seen so far before the write transaction, so
+  // that files which are not in the cache do not prolong it.
+  void HashFiles()
+  {
+    for (FTableMap::iterator p = FTable.begin(), end = FTable.end();
+	 p != end; ++p) {
+      HashFile(*p->second);
+    }
+  }
+
+  // Identifies (and hashes, if needed) the files in TouchedFiles
+  // before the write transaction, like HashFiles.
+  void IdentifyTouchedFiles()
+  {
+    for (TouchedFilesList::iterator p = TouchedFiles.begin(),
+	   end = TouchedFiles.end(); p != end; ++p) {
+      if (Touched.find(*p) != Touched.end()) {
+	continue;
+      }
+      std::tr1::shared_ptr<FileTableEntry> FTE;
+      FTableMap::iterator q = FTable.find(*p);
+      if (q != FTable.end()) {
+	FTE = q->second;
+      } else {
+	FTE.reset(new FileTableEntry(*p, NextKey++));
+	if (FTE->Ident.Valid()) {
+	  if ((q = Included.find(FTE->Ident.Path)) != Included.end()
+	      || (q = FTable.find(FTE->Ident.Path)) != FTable.end()) {
+	    FTE = q->second;
+	  }
+	}
+      }
+      Touched[*p] = FTE;
+      if (FTE->Ident.Valid()) {
+	Included[FTE->Ident.Path] = FTE;
+	if (UseHashes) {
+	  HashFile(*FTE);
+	}
+      }
+    }
+  }
+
+  bool OpenLazily()
+  {
+    if (!Lazy) {
+      return true;
+    }
+    std::string Path(LazyPath);
+    if (Path.empty() && !Database::Locate(Path, DB->ErrorMessage)) {
+      return false;
+    }
+    if (!DB->Open(Path.c_str())) {
+      return false;
+    }
+    Lazy = false;
+    return true;
+  }
+
   std::tr1::shared_ptr<FileTableEntry> Resolve(const std::string &Path)
   {
     FTableMap::iterator p = FTable.find(Path);
     if (p == FTable.end()) {
-      std::tr1::shared_ptr<FileTableEntry> FTE(new FileTableEntry(Path));
+      std::tr1::shared_ptr<FileTableEntry> FTE
+	(new FileTableEntry(Path, NextKey++));
       if (FTE->Ident.Valid()) {
 	p = FTable.find(FTE->Ident.Path);
 	if (p == FTable.end()) {
@@ -110,8 +429,8 @@ struct FileIdentificationDatabase::Impl {
 	FTable[Path] = p->second;
       } else {
 	// Could not resolve file name.
-	DB->ErrorMessage = "could not find file on disk: ";
-	DB->ErrorMessage += Path;
+	ErrorMessage = "could not find file on disk: ";
+	ErrorMessage += Path;
 	return std::tr1::shared_ptr<FileTableEntry>();
       }
     }
@@ -120,16 +439,253 @@ struct FileIdentificationDatabase::Impl {
 
   bool Record
     (const char *Path, unsigned Line, unsigned Column,
-     const char *Tool, const std::string &Message)
+     const char *Tool, const std::string &Message,
+     unsigned long long Fingerprint, unsigned Occurrences)
   {
-    std::tr1::shared_ptr<FileTableEntry> FTE = Resolve(Path);
+    std::tr1::shared_ptr<FileTableEntry> FTE = Resolve(Absolute(Path));
     if (FTE == NULL) {
       return false;
     }
-    Reports.push_back(Report(FTE, Line, Column, Tool, Message));
+    const FileTableEntry *FTEPtr = FTE.get();
+    unsigned long long Hash = HashBytes(HashInitial, &FTEPtr, sizeof(FTEPtr));
+    Hash = HashBytes(Hash, &Line, sizeof(Line));
+    Hash = HashBytes(Hash, &Column, sizeof(Column));
+    Hash = HashBytes(Hash, Tool, strlen(Tool) + 1);
+    Hash = HashString(Hash, Message);
+    std::pair<ReportIndexMap::iterator, ReportIndexMap::iterator> Range
+      = ReportIndex.equal_range(Hash);
+    for (ReportIndexMap::iterator p = Range.first; p != Range.second; ++p) {
+      Report &Existing(Reports[p->second]);
+      if (Existing.SameFinding(FTEPtr, Line, Column, Tool, Message)) {
+	Existing.Occurrences += Occurrences;
+	return true;
+      }
+    }
+    ReportIndex.insert(std::make_pair(Hash, Reports.size()));
+    Reports.push_back(Report(FTE, Line, Column, Tool, Message, Fingerprint));
+    Reports.back().Occurrences = Occurrences;
+    if (Reports.size() >= ChunkSize && PrivateConnection && !FlushChunk()) {
+      ErrorMessage = DB->ErrorMessage;
+      return false;
+    }
+    return true;
+  }
+
+  // Moves the reports in memory to the staging table.  Findings which
+  // are already staged are counted in their occurrences column.
+  TransactionResult::Enum RunFlushTransaction()
+  {
+    Statement Insert, Update;
+    TransactionResult::Enum tret = Insert.TxnPrepare
+      (*DB, "INSERT OR IGNORE INTO temp.staged_reports "
+       "(file_key, line, column, tool, message, fingerprint, occurrences) "
+       "VALUES (?, ?, ?, ?, ?, ?, ?)");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    tret = Update.TxnPrepare
+      (*DB, "UPDATE temp.staged_reports SET occurrences = occurrences + ? "
+       "WHERE file_key = ? AND line = ? AND column = ? AND tool = ? "
+       "AND message = ?");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    for (std::vector<Report>::const_iterator p = Reports.begin(),
+	   end = Reports.end(); p != end; ++p) {
+      sqlite3_reset(Insert.Ptr);
+      sqlite3_bind_int64(Insert.Ptr, 1, p->FI->Key);
+      sqlite3_bind_int64(Insert.Ptr, 2, p->Line);
+      sqlite3_bind_int64(Insert.Ptr, 3, p->Column);
+      sqlite3_bind_text(Insert.Ptr, 4, p->Tool.data(), p->Tool.size(),
+			SQLITE_STATIC);
+      sqlite3_bind_text(Insert.Ptr, 5, p->Message.data(), p->Message.size(),
+			SQLITE_STATIC);
+      sqlite3_bind_int64(Insert.Ptr, 6, p->Fingerprint);
+      sqlite3_bind_int64(Insert.Ptr, 7, p->Occurrences);
+      if (sqlite3_step(Insert.Ptr) != SQLITE_DONE) {
+	return DB->SetTransactionError(sqlite3_sql(Insert.Ptr));
+      }
+      if (sqlite3_changes(DB->Ptr) > 0) {
+	continue;
+      }
+      sqlite3_reset(Update.Ptr);
+      sqlite3_bind_int64(Update.Ptr, 1, p->Occurrences);
+      sqlite3_bind_int64(Update.Ptr, 2, p->FI->Key);
+      sqlite3_bind_int64(Update.Ptr, 3, p->Line);
+      sqlite3_bind_int64(Update.Ptr, 4, p->Column);
+      sqlite3_bind_text(Update.Ptr, 5, p->Tool.data(), p->Tool.size(),
+			SQLITE_STATIC);
+      sqlite3_bind_text(Update.Ptr, 6, p->Message.data(), p->Message.size(),
+			SQLITE_STATIC);
+      if (sqlite3_step(Update.Ptr) != SQLITE_DONE) {
+	return DB->SetTransactionError(sqlite3_sql(Update.Ptr));
+      }
+    }
+    return TransactionResult::COMMIT;
+  }
+
+  bool FlushChunk()
+  {
+    if (!OpenLazily()) {
+      return false;
+    }
+    if (!Staged && !DB->Execute
+	("CREATE TEMP TABLE IF NOT EXISTS staged_reports ("
+	 "file_key INTEGER NOT NULL, "
+	 "line INTEGER NOT NULL, "
+	 "column INTEGER NOT NULL, "
+	 "tool TEXT NOT NULL, "
+	 "message TEXT NOT NULL, "
+	 "fingerprint INTEGER NOT NULL, "
+	 "occurrences INTEGER NOT NULL, "
+	 "UNIQUE (file_key, line, column, tool, message));")) {
+      return false;
+    }
+    if (DB->Transact(std::tr1::bind(&Impl::RunFlushTransaction, this))
+	!= TransactionResult::COMMIT) {
+      return false;
+    }
+    for (std::vector<Report>::const_iterator p = Reports.begin(),
+	   end = Reports.end(); p != end; ++p) {
+      p->FI->StagedCounts[p->Tool] += p->Occurrences;
+    }
+    Staged = true;
+    Reports.clear();
+    ReportIndex.clear();
     return true;
   }
 
+  // Copies the staged reports to the reports table, using the file
+  // IDs assigned by RunCommitTransaction.  The staging table is
+  // emptied by ClearStaged after the commit.
+  TransactionResult::Enum PublishStaged(SummaryDelta &Delta)
+  {
+    Statement Copy;
+    TransactionResult::Enum tret = Copy.TxnPrepare
+      (*DB, "INSERT INTO reports "
+       "(file, line, column, tool, message, fingerprint, occurrences) "
+       "SELECT ?, line, column, tool, message, fingerprint, occurrences "
+       "FROM temp.staged_reports WHERE file_key = ? ORDER BY rowid");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    for (FTableMap::const_iterator p = FTable.begin(),
+	   end = FTable.end(); p != end; ++p) {
+      const FileTableEntry &FTE(*p->second);
+      if (p->first != FTE.Ident.Path) {
+	continue;
+      }
+      sqlite3_reset(Copy.Ptr);
+      sqlite3_bind_int64(Copy.Ptr, 1, FTE.ID);
+      sqlite3_bind_int64(Copy.Ptr, 2, FTE.Key);
+      if (sqlite3_step(Copy.Ptr) != SQLITE_DONE) {
+	return DB->SetTransactionError(sqlite3_sql(Copy.Ptr));
+      }
+      for (std::map<std::string, long long>::const_iterator
+	     q = FTE.StagedCounts.begin(), qend = FTE.StagedCounts.end();
+	   q != qend; ++q) {
+	Delta[std::make_pair(q->first, FTE.Directory)] += q->second;
+      }
+    }
+    return TransactionResult::COMMIT;
+  }
+
+  // Empties the staging table after the reports have been published.
+  bool ClearStaged()
+  {
+    if (!DB->Execute("DELETE FROM temp.staged_reports")) {
+      return false;
+    }
+    for (FTableMap::const_iterator p = FTable.begin(),
+	   end = FTable.end(); p != end; ++p) {
+      p->second->StagedCounts.clear();
+    }
+    Staged = false;
+    return true;
+  }
+
+  // Subtracts the reports of the latest version of Path from the
+  // summary, because the version is about to be superseded.
+  TransactionResult::Enum SubtractSuperseded
+    (Statement &Latest, Statement &Counts, const FileTableEntry &FTE,
+     SummaryDelta &Delta)
+  {
+    sqlite3_reset(Latest.Ptr);
+    sqlite3_bind_text(Latest.Ptr, 1, FTE.Ident.Path.data(),
+		      FTE.Ident.Path.size(), SQLITE_TRANSIENT);
+    int ret = sqlite3_step(Latest.Ptr);
+    if (ret == SQLITE_DONE) {
+      return TransactionResult::COMMIT;
+    }
+    if (ret != SQLITE_ROW) {
+      return DB->SetTransactionError(sqlite3_sql(Latest.Ptr));
+    }
+    sqlite3_reset(Counts.Ptr);
+    sqlite3_bind_int64(Counts.Ptr, 1, sqlite3_column_int64(Latest.Ptr, 0));
+    while ((ret = sqlite3_step(Counts.Ptr)) == SQLITE_ROW) {
+      std::string Tool((const char *)sqlite3_column_text(Counts.Ptr, 0));
+      Delta[std::make_pair(Tool, FTE.Directory)]
+	-= sqlite3_column_int64(Counts.Ptr, 1);
+    }
+    if (ret != SQLITE_DONE) {
+      return DB->SetTransactionError(sqlite3_sql(Counts.Ptr));
+    }
+    return TransactionResult::COMMIT;
+  }
+
+  // Replaces the includes of the main file with Included, together
+  // with the identification computed by IdentifyTouchedFiles.
+  TransactionResult::Enum StoreIncludes()
+  {
+    if (MainFile.empty()) {
+      return TransactionResult::COMMIT;
+    }
+    Statement Delete, Insert;
+    TransactionResult::Enum tret = Delete.TxnPrepare
+      (*DB, "DELETE FROM includes WHERE tu = ?");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    tret = Insert.TxnPrepare
+      (*DB, "INSERT OR IGNORE INTO includes (tu, file, mtime, size, hash) "
+       "VALUES (?, ?, ?, ?, ?)");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    sqlite3_bind_text(Delete.Ptr, 1, MainFile.data(), MainFile.size(),
+		      SQLITE_TRANSIENT);
+    if (sqlite3_step(Delete.Ptr) != SQLITE_DONE) {
+      return DB->SetTransactionError(sqlite3_sql(Delete.Ptr));
+    }
+    sqlite3_bind_text(Insert.Ptr, 1, MainFile.data(), MainFile.size(),
+		      SQLITE_TRANSIENT);
+    for (FTableMap::const_iterator p = Included.begin(),
+	   end = Included.end(); p != end; ++p) {
+      const FileTableEntry &FTE(*p->second);
+      const FileIdentification &FI(FTE.Ident);
+      sqlite3_reset(Insert.Ptr);
+      sqlite3_bind_text(Insert.Ptr, 2, FI.Path.data(), FI.Path.size(),
+			SQLITE_TRANSIENT);
+      sqlite3_bind_int64(Insert.Ptr, 3, FI.Mtime);
+      sqlite3_bind_int64(Insert.Ptr, 4, FI.Size);
+      if (UseHashes && FTE.HashValid) {
+	sqlite3_bind_int64(Insert.Ptr, 5, FTE.Hash);
+	if (!FTE.HashCached) {
+	  tret = CacheContentHash(*DB, FI, FTE.Hash);
+	  if (tret != TransactionResult::COMMIT) {
+	    return tret;
+	  }
+	}
+      } else {
+	sqlite3_bind_null(Insert.Ptr, 5);
+      }
+      if (sqlite3_step(Insert.Ptr) != SQLITE_DONE) {
+	return DB->SetTransactionError(sqlite3_sql(Insert.Ptr));
+      }
+    }
+    return TransactionResult::COMMIT;
+  }
+
   TransactionResult::Enum RunCommitTransaction()
   {
     TransactionResult::Enum tret;
@@ -140,13 +696,38 @@ struct FileIdentificationDatabase::Impl {
 	return tret;
       }
     }
+    tret = StoreIncludes();
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+
+    // The summary counts are adjusted for the superseded file
+    // versions and the new reports.
+    SummaryDelta Delta;
+    Statement Latest, Counts;
+    tret = Latest.TxnPrepare
+      (*DB, "SELECT id FROM files WHERE path = ? ORDER BY id DESC LIMIT 1");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
+    tret = Counts.TxnPrepare
+      (*DB, "SELECT tool, SUM(occurrences) FROM reports "
+       "WHERE file = ? GROUP BY tool");
+    if (tret != TransactionResult::COMMIT) {
+      return tret;
+    }
 
     Statement stmt;
     tret = stmt.TxnPrepare
-      (*DB, "INSERT INTO files (path, mtime, size) VALUES (?, ?, ?)");
+      (*DB, UseHashes
+       ? "INSERT INTO files (path, mtime, size, analyzed, hash) "
+       "VALUES (?, ?, ?, ?, ?)"
+       : "INSERT INTO files (path, mtime, size, analyzed) "
+       "VALUES (?, ?, ?, ?)");
     if (tret != TransactionResult::COMMIT) {
       return tret;
     }
+    time_t Now = time(NULL);
     for (FTableMap::const_iterator p = FTable.begin(),
 	   end = FTable.end(); p != end; ++p) {
       const FileIdentification &FI(p->second->Ident);
@@ -155,21 +736,51 @@ struct FileIdentificationDatabase::Impl {
 	// shadowing the real entry.
 	continue;
       }
+      p->second->Directory = SummaryDirectory(*DB, FI.Path);
+      tret = SubtractSuperseded(Latest, Counts, *p->second, Delta);
+      if (tret != TransactionResult::COMMIT) {
+	return tret;
+      }
       sqlite3_reset(stmt.Ptr);
       sqlite3_bind_text(stmt.Ptr, 1, FI.Path.data(), FI.Path.size(),
 			SQLITE_TRANSIENT);
       sqlite3_bind_int64(stmt.Ptr, 2, FI.Mtime);
       sqlite3_bind_int64(stmt.Ptr, 3, FI.Size);
+      sqlite3_bind_int64(stmt.Ptr, 4, Now);
+      if (UseHashes) {
+	// Hashed by HashFiles or IdentifyTouchedFiles.
+	const FileTableEntry &FTE(*p->second);
+	if (FTE.HashValid) {
+	  sqlite3_bind_int64(stmt.Ptr, 5, FTE.Hash);
+	  if (!FTE.HashCached) {
+	    tret = CacheContentHash(*DB, FI, FTE.Hash);
+	    if (tret != TransactionResult::COMMIT) {
+	      return tret;
+	    }
+	  }
+	} else {
+	  sqlite3_bind_null(stmt.Ptr, 5);
+	}
+      }
       if (sqlite3_step(stmt.Ptr) != SQLITE_DONE) {
 	return DB->SetTransactionError(sqlite3_sql(stmt.Ptr));
       }
       p->second->ID = sqlite3_last_insert_rowid(DB->Ptr);
     }
 
+    if (Staged) {
+      tret = PublishStaged(Delta);
+      if (tret != TransactionResult::COMMIT) {
+	return tret;
+      }
+      return UpdateSummary(*DB, Delta);
+    }
+
     tret = stmt.TxnPrepare
       (*DB,
-       "INSERT INTO reports (file, line, column, tool, message) "
-       "VALUES (?, ?, ?, ?, ?);");
+       "INSERT INTO reports "
+       "(file, line, column, tool, message, fingerprint, occurrences) "
+       "VALUES (?, ?, ?, ?, ?, ?, ?);");
     if (tret != TransactionResult::COMMIT) {
       return tret;
     }
@@ -184,27 +795,53 @@ struct FileIdentificationDatabase::Impl {
 			SQLITE_TRANSIENT);
       sqlite3_bind_text(stmt.Ptr, 5, p->Message.data(), p->Message.size(),
 			SQLITE_TRANSIENT);
+      sqlite3_bind_int64(stmt.Ptr, 6, p->Fingerprint);
+      sqlite3_bind_int64(stmt.Ptr, 7, p->Occurrences);
       if (sqlite3_step(stmt.Ptr) != SQLITE_DONE) {
 	return DB->SetTransactionError(sqlite3_sql(stmt.Ptr));
       }
+      Delta[std::make_pair(p->Tool, p->FI->Directory)] += p->Occurrences;
     }
-    return TransactionResult::COMMIT;
+    return UpdateSummary(*DB, Delta);
   }
 
   bool Commit()
   {
+    if (!OpenLazily()) {
+      return false;
+    }
+    if (Staged && !Reports.empty() && !FlushChunk()) {
+      return false;
+    }
+    if (!HashesChecked) {
+      UseHashes = HasContentHashes(*DB);
+      HashesChecked = true;
+    }
+    if (UseHashes) {
+      HashFiles();
+    }
+    IdentifyTouchedFiles();
+    // The connection may be shared, so its RetryCount covers the
+    // commits of other objects, too.
+    unsigned Before = DB->RetryCount;
     TransactionResult::Enum result = DB->Transact(std::tr1::bind(&Impl::RunCommitTransaction, this));
-    return result == TransactionResult::COMMIT;
+    CommitRetries = DB->RetryCount - Before;
+    if (result != TransactionResult::COMMIT) {
+      return false;
+    }
+    return !Staged || ClearStaged();
   }
 
   TransactionResult::Enum MarkAsProcessed(const std::string &Path)
   {
-    std::string Absolute;
-    if (!ResolvePath(Path.c_str(), Absolute)) {
+    FTableMap::iterator p = Touched.find(Path);
+    if (p == Touched.end() || !p->second->Ident.Valid()) {
       DB->ErrorMessage = "could not find file on disk: ";
       DB->ErrorMessage += Path;
       return TransactionResult::ERROR;
     }
+    std::tr1::shared_ptr<FileTableEntry> FTE(p->second);
+    const std::string &Absolute(FTE->Ident.Path);
 
     Statement SQL;
     TransactionResult::Enum tret =
@@ -225,9 +862,13 @@ struct FileIdentificationDatabase::Impl {
     }
     // Add an entry for the file, hiding the previous reports.
     // TODO: Only hide changed files? What about plugin changes?
-    if (Resolve(Path) == NULL) {
-      return TransactionResult::ERROR;
+    // The entry is shared with Touched and Included, like Resolve
+    // shares entries between spellings of the same path.
+    std::tr1::shared_ptr<FileTableEntry> &Entry(FTable[Absolute]);
+    if (Entry == NULL) {
+      Entry = FTE;
     }
+    FTable[Path] = Entry;
     return TransactionResult::COMMIT;
   }
 };
@@ -237,37 +878,74 @@ FileIdentificationDatabase::FileIdentificationDatabase(std::tr1::shared_ptr<Data
 {
 }
 
+FileIdentificationDatabase::FileIdentificationDatabase(const std::string &Path)
+  : impl(new Impl(std::tr1::shared_ptr<Database>(new Database)))
+{
+  impl->Lazy = true;
+  impl->LazyPath = Path;
+  impl->PrivateConnection = true;
+}
+
 FileIdentificationDatabase::~FileIdentificationDatabase()
 {
 }
 
 bool FileIdentificationDatabase::isOpen() const
 {
-  return impl->DB->Ptr != NULL;
+  return impl->DB->Ptr != NULL || impl->Lazy;
 }
 
 std::string FileIdentificationDatabase::ErrorMessage() const
 {
-  return impl->DB->ErrorMessage;
+  return impl->ErrorMessage;
 }
 
 bool
 FileIdentificationDatabase::Report
   (const char *Path, unsigned Line, unsigned Column,
-   const char *Tool, const std::string &Message)
+   const char *Tool, const std::string &Message,
+   unsigned long long Fingerprint, unsigned Occurrences)
 {
-  return impl->Record(Path, Line, Column, Tool, Message);
+  return impl->Record(Path, Line, Column, Tool, Message, Fingerprint,
+		      Occurrences);
 }
 
 void
 FileIdentificationDatabase::MarkForProcessing(const char *Path)
 {
-  impl->TouchedFiles.push_back(Path);
+  impl->TouchedFiles.push_back(impl->Absolute(Path));
+}
+
+void
+FileIdentificationDatabase::SetMainFile(const char *Path)
+{
+  if (!ResolvePath(impl->Absolute(Path).c_str(), impl->MainFile)) {
+    impl->MainFile.clear();
+  }
+}
+
+void
+FileIdentificationDatabase::SetDirectory(const std::string &Directory)
+{
+  impl->Directory = Directory;
+  if (!Directory.empty() && Directory[Directory.size() - 1] != '/') {
+    impl->Directory += '/';
+  }
 }
 
 bool
 FileIdentificationDatabase::Commit()
 {
-  return impl->Commit();
+  if (!impl->Commit()) {
+    impl->ErrorMessage = impl->DB->ErrorMessage;
+    return false;
+  }
+  return true;
+}
+
+unsigned
+FileIdentificationDatabase::Retries() const
+{
+  return impl->CommitRetries;
 }
 
@@ -20,12 +20,17 @@
 
 #include "db.hpp"
 
+#include <map>
+#include <string>
 #include <tr1/memory>
+#include <vector>
 
 struct FileIdentification {
   std::string Path; // canonical path
   time_t Mtime;
   unsigned long long Size;
+  unsigned long long Device;	// for the content hash cache
+  unsigned long long Inode;
 
   // Initializes the object with the data form the specified file.
   FileIdentification(const char *path);
@@ -38,19 +43,89 @@ private:
   std::tr1::shared_ptr<Impl> impl;
 public:
   FileIdentificationDatabase(std::tr1::shared_ptr<Database> db);
+
+  // The database at Path (or the one found by Database::Locate if
+  // Path is empty) is opened by the first call to Commit, so that
+  // compiler invocations which fail early do not pay for it.
+  explicit FileIdentificationDatabase(const std::string &Path);
   ~FileIdentificationDatabase();
 
+  // Returns true if the database is open or will be opened on commit.
   bool isOpen() const;
   std::string ErrorMessage() const;
 
+  // Records a finding.  Fingerprint identifies the finding across
+  // versions of the file.  Occurrences is the number of identical
+  // findings the call stands for.
   bool Report(const char *Path,
 	      unsigned Line, unsigned Column, const char *Tool,
-	      const std::string &Message);
+	      const std::string &Message, unsigned long long Fingerprint,
+	      unsigned Occurrences = 1);
 
   // Record that the file is subject to processing.  A database entry
   // is added, masking previous reports for the same file.
   void MarkForProcessing(const char *Path);
 
+  // Records Path as the main file of the translation unit.  The
+  // commit stores the files passed to MarkForProcessing as the files
+  // it includes, replacing those of its previous commit.
+  void SetMainFile(const char *Path);
+
+  // Relative paths passed to Report and MarkForProcessing are
+  // interpreted relative to Directory instead of the current
+  // directory.
+  void SetDirectory(const std::string &Directory);
+
   // Write the report to the database.
   bool Commit();
+
+  // Number of times the transaction of the last commit had to be
+  // retried.
+  unsigned Retries() const;
 };
+
+// Changes to the summary table, indexed by tool and directory.
+typedef std::map<std::pair<std::string, std::string>, long long>
+  SummaryDelta;
+
+// Returns the directory under which the file Path (an absolute path)
+// is counted in the summary table: the top-level directory relative
+// to the database, or the top-level directory of the file system for
+// files outside it.
+std::string SummaryDirectory(Database &, const std::string &Path);
+
+// Adds the changes to the summary table.  Must be called within a
+// transaction.
+TransactionResult::Enum UpdateSummary(Database &, const SummaryDelta &);
+
+// Content hashes identify file versions whose modification time has
+// changed, but not their contents, for example after switching
+// branches.  They are recorded if the database was set up with
+// "create-db --content-hash".
+
+// Returns true if the database records content hashes.
+bool HasContentHashes(Database &);
+
+// Determines the FastHash of the contents of the file.  The
+// file_hashes table serves as a cache, keyed by device, inode,
+// modification time and size.  Cached is set if the hash was found
+// there.  Returns false if the file cannot be read.
+bool ContentHash(Database &, const FileIdentification &,
+		 unsigned long long &Hash, bool &Cached);
+
+// Adds the hash of the file to the cache.  Must be called within a
+// transaction.
+TransactionResult::Enum CacheContentHash(Database &,
+					 const FileIdentification &,
+					 unsigned long long Hash);
+
+// Hashes computed by ContentHash which were not in the cache.
+typedef std::vector<std::pair<FileIdentification, unsigned long long> >
+  ContentHashList;
+
+// Adds the hashes to the cache of the database file of DB, which may
+// be opened read-only.  This opens a separate connection for writing
+// and uses one short transaction, so readers call it after their
+// pass over the database.  On failure, the error message is in
+// DB.ErrorMessage.
+bool StoreContentHashes(Database &DB, const ContentHashList &);
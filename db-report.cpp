@@ -21,23 +21,151 @@
 #include "db-report.hpp"
 
 #include <stdio.h>
+#include <stdlib.h>
+
+void
+ReportFilter::SetPathPrefix(const std::string &Prefix)
+{
+  // Quote the GLOB metacharacters, so that the prefix is matched
+  // literally.
+  PathGlob.clear();
+  for (std::string::const_iterator p = Prefix.begin(), end = Prefix.end();
+       p != end; ++p) {
+    switch (*p) {
+    case '*':
+    case '?':
+    case '[':
+      PathGlob += '[';
+      PathGlob += *p;
+      PathGlob += ']';
+      break;
+    default:
+      PathGlob += *p;
+    }
+  }
+  PathGlob += '*';
+}
+
+namespace {
+  // Appends " AND tool IN (?, ?, ...)" if the filter restricts tools.
+  void
+  AppendToolCondition(std::string &SQL, const char *Column,
+		      const ReportFilter &Filter)
+  {
+    if (Filter.Tools.empty()) {
+      return;
+    }
+    SQL += " AND ";
+    SQL += Column;
+    SQL += " IN (";
+    for (size_t i = 0; i < Filter.Tools.size(); ++i) {
+      if (i > 0) {
+	SQL += ", ";
+      }
+      SQL += '?';
+    }
+    SQL += ')';
+  }
+
+  // Appends the conditions on files.path and files.analyzed.
+  void
+  AppendFileConditions(std::string &SQL, const ReportFilter &Filter)
+  {
+    if (!Filter.PathGlob.empty()) {
+      SQL += " AND files.path GLOB ?";
+    }
+    if (Filter.AnalyzedSince != 0) {
+      SQL += " AND files.analyzed >= ?";
+    }
+  }
+
+  // Binds the tool names starting at parameter Index.  Returns the
+  // index of the next parameter.
+  int
+  BindTools(Statement &Stmt, int Index, const ReportFilter &Filter)
+  {
+    for (std::vector<std::string>::const_iterator
+	   p = Filter.Tools.begin(), end = Filter.Tools.end();
+	 p != end; ++p) {
+      sqlite3_bind_text(Stmt.Ptr, Index, p->data(), p->size(),
+			SQLITE_TRANSIENT);
+      ++Index;
+    }
+    return Index;
+  }
+
+  // Binds the parameters added by AppendFileConditions.
+  int
+  BindFileConditions(Statement &Stmt, int Index, const ReportFilter &Filter)
+  {
+    if (!Filter.PathGlob.empty()) {
+      sqlite3_bind_text(Stmt.Ptr, Index, Filter.PathGlob.data(),
+			Filter.PathGlob.size(), SQLITE_TRANSIENT);
+      ++Index;
+    }
+    if (Filter.AnalyzedSince != 0) {
+      sqlite3_bind_int64(Stmt.Ptr, Index, Filter.AnalyzedSince);
+      ++Index;
+    }
+    return Index;
+  }
+}
 
 bool
 Report(Database &DB, ReportCallback CB)
+{
+  return Report(DB, ReportFilter(), CB);
+}
+
+bool
+Report(Database &DB, const ReportFilter &Filter, ReportCallback CB,
+       unsigned long long *Skipped)
 {
   // Iterate over all the file names for which we have got anything to
   // report.  For each file, we try to locate the correct internal
-  // file ID based for the current file on the disk.
-  Statement FileList, FileID, Report;
-  if (!(FileList.Prepare(DB, "SELECT DISTINCT path FROM files ORDER BY path")
-	&& FileID.Prepare(DB, "SELECT id FROM files "
+  // file ID based for the current file on the disk.  If the filter
+  // restricts the tools, the file list is obtained from the
+  // reports_tool index, so that the cost depends on the number of
+  // matching reports, and not on the size of the database.
+  std::string FileListSQL;
+  if (Filter.Tools.empty()) {
+    FileListSQL = "SELECT DISTINCT files.path FROM files WHERE 1";
+  } else {
+    FileListSQL = "SELECT DISTINCT files.path FROM reports "
+      "JOIN files ON files.id = reports.file WHERE 1";
+    AppendToolCondition(FileListSQL, "reports.tool", Filter);
+  }
+  AppendFileConditions(FileListSQL, Filter);
+  FileListSQL += " ORDER BY files.path";
+
+  std::string ReportSQL = "SELECT line, column, tool, message, occurrences "
+    "FROM reports WHERE file = ?";
+  AppendToolCondition(ReportSQL, "tool", Filter);
+  ReportSQL += " ORDER BY rowid";
+
+  Statement FileList, FileID, FileHash, Report;
+  if (!(FileList.Prepare(DB, FileListSQL.c_str())
+	&& FileID.Prepare(DB, "SELECT id, analyzed FROM files "
 			  "WHERE path = ? AND mtime = ? AND size = ? "
 			  "ORDER BY id DESC LIMIT 1")
-	&& Report.Prepare(DB, "SELECT DISTINCT line, column, tool, message "
-			  "FROM reports WHERE file = ? ORDER BY rowid"))) {
+	&& Report.Prepare(DB, ReportSQL.c_str()))) {
     fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
     return false;
   }
+  // If the modification time of a file has changed, the version with
+  // the same contents is used.
+  if (HasContentHashes(DB)
+      && !FileHash.Prepare(DB, "SELECT id, analyzed FROM files "
+			   "WHERE path = ? AND hash = ? "
+			   "ORDER BY id DESC LIMIT 1")) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  BindFileConditions(FileList, BindTools(FileList, 1, Filter), Filter);
+
+  // Hashes which were not in the cache are stored after the pass,
+  // because DB may be read-only.
+  ContentHashList NewHashes;
   bool result = true;
   while (1) {
     int ret = sqlite3_step(FileList.Ptr);
@@ -52,7 +180,11 @@ Report(Database &DB, ReportCallback CB)
     FileIdentification FI(path);
     if (!FI.Valid()) {
       fprintf(stderr, "%s: error: could not find file on disk\n", path);
-      result = false;
+      if (Skipped != NULL) {
+	++*Skipped;
+      } else {
+	result = false;
+      }
       continue;
     }
     sqlite3_reset(FileID.Ptr);
@@ -60,19 +192,42 @@ Report(Database &DB, ReportCallback CB)
     sqlite3_bind_int64(FileID.Ptr, 2, FI.Mtime);
     sqlite3_bind_int64(FileID.Ptr, 3, FI.Size);
     ret = sqlite3_step(FileID.Ptr);
+    Statement *Found = &FileID;
+    unsigned long long Hash;
+    bool Cached;
+    if (ret == SQLITE_DONE && FileHash.Ptr != NULL
+	&& ContentHash(DB, FI, Hash, Cached)) {
+      if (!Cached) {
+	NewHashes.push_back(std::make_pair(FI, Hash));
+      }
+      sqlite3_reset(FileHash.Ptr);
+      sqlite3_bind_text(FileHash.Ptr, 1, path, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int64(FileHash.Ptr, 2, Hash);
+      ret = sqlite3_step(FileHash.Ptr);
+      Found = &FileHash;
+    }
     if (ret == SQLITE_DONE) {
       fprintf(stderr, "%s: error: could not find report for current file\n",
 	      path);
-      result = false;
+      if (Skipped != NULL) {
+	++*Skipped;
+      } else {
+	result = false;
+      }
       continue;
     }
     if (ret != SQLITE_ROW) {
       fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
       return false;
     }
-    sqlite_int64 FID = sqlite3_column_int64(FileID.Ptr, 0);
+    sqlite_int64 FID = sqlite3_column_int64(Found->Ptr, 0);
+    if (sqlite3_column_int64(Found->Ptr, 1) < Filter.AnalyzedSince) {
+      // An older analysis of the current file version.
+      continue;
+    }
     sqlite3_reset(Report.Ptr);
     sqlite3_bind_int64(Report.Ptr, 1, FID);
+    BindTools(Report, 2, Filter);
     while (1) {
       ret = sqlite3_step(Report.Ptr);
       if (ret == SQLITE_DONE) {
@@ -86,14 +241,212 @@ Report(Database &DB, ReportCallback CB)
       unsigned column = sqlite3_column_int64(Report.Ptr, 1);
       const char *tool = (const char *)sqlite3_column_text(Report.Ptr, 2);
       const char *message = (const char *)sqlite3_column_text(Report.Ptr, 3);
-      if (!CB(path, line, column, tool, message)) {
+      unsigned occurrences = sqlite3_column_int64(Report.Ptr, 4);
+      if (!CB(path, line, column, tool, message, occurrences)) {
 	break;
       }
     }
   }
+  // Without the cache, the next run would read these files again.
+  if (!StoreContentHashes(DB, NewHashes)) {
+    fprintf(stderr, "warning: could not cache content hashes: %s\n",
+	    DB.ErrorMessage.c_str());
+  }
   return result;
 }
 
+namespace {
+  // Runs Stmt, which selects line, column, tool, message and
+  // occurrences, and passes the rows to CB.  Returns false on database errors.
+  bool
+  ReportChangedRows(Database &DB, Statement &Stmt, bool Added,
+		    const char *Path, ChangeCallback CB)
+  {
+    while (1) {
+      int ret = sqlite3_step(Stmt.Ptr);
+      if (ret == SQLITE_DONE) {
+	return true;
+      }
+      if (ret != SQLITE_ROW) {
+	DB.SetError(sqlite3_sql(Stmt.Ptr));
+	return false;
+      }
+      unsigned line = sqlite3_column_int64(Stmt.Ptr, 0);
+      unsigned column = sqlite3_column_int64(Stmt.Ptr, 1);
+      const char *tool = (const char *)sqlite3_column_text(Stmt.Ptr, 2);
+      const char *message = (const char *)sqlite3_column_text(Stmt.Ptr, 3);
+      unsigned occurrences = sqlite3_column_int64(Stmt.Ptr, 4);
+      if (!CB(Added, Path, line, column, tool, message, occurrences)) {
+	return true;
+      }
+    }
+  }
+}
+
+bool
+ReportSinceSnapshot(Database &DB, const char *Snapshot,
+		    const ReportFilter &Filter, ChangeCallback CB)
+{
+  Statement Lookup;
+  if (!Lookup.Prepare(DB, "SELECT last_file FROM snapshots WHERE name = ?")) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  sqlite3_bind_text(Lookup.Ptr, 1, Snapshot, -1, SQLITE_TRANSIENT);
+  int ret = sqlite3_step(Lookup.Ptr);
+  if (ret == SQLITE_DONE) {
+    fprintf(stderr, "error: unknown snapshot: %s\n", Snapshot);
+    return false;
+  }
+  if (ret != SQLITE_ROW) {
+    DB.SetError(sqlite3_sql(Lookup.Ptr));
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  return ReportChangesSince(DB, sqlite3_column_int64(Lookup.Ptr, 0),
+			    Filter, CB);
+}
+
+bool
+ReportChangesSince(Database &DB, long long Baseline,
+		   const ReportFilter &Filter, ChangeCallback CB)
+{
+  // File IDs grow monotonically, so the file versions recorded after
+  // the snapshot are exactly those with a larger ID.  Files which have
+  // not been processed again since the snapshot are never looked at.
+  std::string ChangedSQL = "SELECT files.path, MAX(files.id) FROM files "
+    "WHERE files.id > ?";
+  AppendFileConditions(ChangedSQL, Filter);
+  ChangedSQL += " GROUP BY files.path ORDER BY files.path";
+
+  // Findings present in the first file version, but not in the
+  // second, compared by fingerprint.  Identical code in one function
+  // produces several findings with the same fingerprint, so the
+  // findings are compared as multisets: if the first version has more
+  // findings with a fingerprint than the second, the surplus ones
+  // (the last by rowid) are reported.  A changed count of an
+  // aggregated finding shows up as a removal and an addition.
+  std::string DiffSQL = "SELECT line, column, tool, message, occurrences "
+    "FROM reports AS r WHERE file = ?1 AND "
+    "(SELECT COUNT(*) FROM reports WHERE file = ?1 "
+    "AND fingerprint = r.fingerprint AND occurrences = r.occurrences "
+    "AND rowid < r.rowid) >= "
+    "(SELECT COUNT(*) FROM reports WHERE file = ?2 "
+    "AND fingerprint = r.fingerprint AND occurrences = r.occurrences)";
+  AppendToolCondition(DiffSQL, "tool", Filter);
+  DiffSQL += " ORDER BY rowid";
+
+  Statement Changed, Previous, Diff;
+  if (!(Changed.Prepare(DB, ChangedSQL.c_str())
+	&& Previous.Prepare(DB, "SELECT id FROM files "
+			    "WHERE path = ? AND id <= ? "
+			    "ORDER BY id DESC LIMIT 1")
+	&& Diff.Prepare(DB, DiffSQL.c_str()))) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  sqlite3_bind_int64(Changed.Ptr, 1, Baseline);
+  BindFileConditions(Changed, 2, Filter);
+
+  int ret;
+  while (1) {
+    ret = sqlite3_step(Changed.Ptr);
+    if (ret == SQLITE_DONE) {
+      break;
+    }
+    if (ret != SQLITE_ROW) {
+      DB.SetError(sqlite3_sql(Changed.Ptr));
+      fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+      return false;
+    }
+    const char *path = (const char *)sqlite3_column_text(Changed.Ptr, 0);
+    sqlite_int64 Current = sqlite3_column_int64(Changed.Ptr, 1);
+
+    // Zero does not match any file, so all findings in files which
+    // are new since the snapshot are reported as added.
+    sqlite_int64 Old = 0;
+    sqlite3_reset(Previous.Ptr);
+    sqlite3_bind_text(Previous.Ptr, 1, path, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(Previous.Ptr, 2, Baseline);
+    ret = sqlite3_step(Previous.Ptr);
+    if (ret == SQLITE_ROW) {
+      Old = sqlite3_column_int64(Previous.Ptr, 0);
+    } else if (ret != SQLITE_DONE) {
+      DB.SetError(sqlite3_sql(Previous.Ptr));
+      fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+      return false;
+    }
+
+    for (int Added = 0; Added < 2; ++Added) {
+      sqlite3_reset(Diff.Ptr);
+      sqlite3_bind_int64(Diff.Ptr, 1, Added ? Current : Old);
+      sqlite3_bind_int64(Diff.Ptr, 2, Added ? Old : Current);
+      BindTools(Diff, 3, Filter);
+      if (!ReportChangedRows(DB, Diff, Added, path, CB)) {
+	fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool
+LastFileID(Database &DB, long long &LastFile)
+{
+  Statement Stmt;
+  if (!Stmt.Prepare(DB, "SELECT IFNULL(MAX(id), 0) FROM files")) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  if (sqlite3_step(Stmt.Ptr) != SQLITE_ROW) {
+    DB.SetError(sqlite3_sql(Stmt.Ptr));
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  LastFile = sqlite3_column_int64(Stmt.Ptr, 0);
+  return true;
+}
+
+bool
+ReportSummary(Database &DB, SummaryKind::Enum Kind, SummaryCallback CB)
+{
+  const char *SQL;
+  switch (Kind) {
+  case SummaryKind::Tool:
+    SQL = "SELECT tool, SUM(count) FROM summary "
+      "GROUP BY tool HAVING SUM(count) != 0 ORDER BY tool";
+    break;
+  case SummaryKind::Directory:
+    SQL = "SELECT directory, SUM(count) FROM summary "
+      "GROUP BY directory HAVING SUM(count) != 0 ORDER BY directory";
+    break;
+  default:
+    abort();
+  }
+  Statement Summary;
+  if (!Summary.Prepare(DB, SQL)) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  while (1) {
+    int ret = sqlite3_step(Summary.Ptr);
+    if (ret == SQLITE_DONE) {
+      break;
+    }
+    if (ret != SQLITE_ROW) {
+      DB.SetError(SQL);
+      fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+      return false;
+    }
+    const char *key = (const char *)sqlite3_column_text(Summary.Ptr, 0);
+    if (!CB(key, sqlite3_column_int64(Summary.Ptr, 1))) {
+      break;
+    }
+  }
+  return true;
+}
+
 std::string
 Carets(const std::string &Text,
        unsigned Column, unsigned Width)
@@ -20,22 +20,104 @@
 
 #include <tr1/functional>
 #include <string>
+#include <vector>
+
+#include <time.h>
 
 class Database;
 
 // Callback function processing report data.
 // Called repeatedly as long as the function returns true
 // and there is more data.  The string arguments point to temporary
-// values owned by the caller.
+// values owned by the caller.  Occurrences is the number of findings
+// the row stands for, which is larger than one for the findings of
+// aggregated tools (counted per function).
 typedef std::tr1::function<bool(const char *RelativePath,
 				unsigned LineNumber, unsigned ColumnNumber,
-				const char *ToolName, const char *Message)>
+				const char *ToolName, const char *Message,
+				unsigned Occurrences)>
   ReportCallback;
 
 
+// Callback function processing the difference between two sets of
+// file versions.  Added is true for new findings and false for
+// findings which are no longer present.  Otherwise, it is used like
+// ReportCallback.
+typedef std::tr1::function<bool(bool Added, const char *RelativePath,
+				unsigned LineNumber, unsigned ColumnNumber,
+				const char *ToolName, const char *Message,
+				unsigned Occurrences)>
+  ChangeCallback;
+
+// Callback function processing summary rows: a tool name or
+// directory, and the number of findings for it (aggregated rows
+// count with their occurrences).
+typedef std::tr1::function<bool(const char *Key, unsigned long long Count)>
+  SummaryCallback;
+
+struct SummaryKind {
+  typedef enum Enum {
+    Tool,			// Group by tool name
+    Directory			// Group by top-level directory
+  } Enum;
+private:
+  SummaryKind();		// not implemented
+  ~SummaryKind();		// not implemented
+};
+
+// Restricts the results produced by Report.  The conditions are
+// translated to SQL, so that only matching rows are read from the
+// database.  A default-constructed filter matches everything.
+struct ReportFilter {
+  // Tool names to report.  Empty means all tools.
+  std::vector<std::string> Tools;
+
+  // SQLite GLOB pattern which the canonical path has to match.
+  // Empty means all paths.
+  std::string PathGlob;
+
+  // Only report files analyzed at or after this time.  Zero means no
+  // restriction.
+  time_t AnalyzedSince;
+
+  ReportFilter() : AnalyzedSince(0) { }
+
+  // Sets PathGlob to match all paths starting with Prefix.
+  void SetPathPrefix(const std::string &Prefix);
+};
+
 // Run the callback against the database.
 bool Report(Database &, ReportCallback);
 
+// Run the callback against the database rows matching the filter.
+// Files which are missing on disk, or whose current version has not
+// been analyzed, are skipped with an error message, and the result is
+// false.  If Skipped is not NULL, these files are counted there
+// instead, and only database errors make the result false.  Content
+// hashes computed along the way are added to the cache afterwards.
+bool Report(Database &, const ReportFilter &, ReportCallback,
+	    unsigned long long *Skipped = NULL);
+
+// Reports the findings which have been added or removed in the files
+// processed after the named snapshot was recorded.  Only the latest
+// version of each file is considered.
+bool ReportSinceSnapshot(Database &, const char *Snapshot,
+			 const ReportFilter &, ChangeCallback);
+
+// Like ReportSinceSnapshot, but the baseline is given as a file ID:
+// the file versions with a larger ID are compared with the latest
+// version of the same path at or below Baseline.
+bool ReportChangesSince(Database &, long long Baseline,
+			const ReportFilter &, ChangeCallback);
+
+// Stores the largest file ID (zero if there are no files) in
+// LastFile.  Later file versions have larger IDs.
+bool LastFileID(Database &, long long &LastFile);
+
+// Reports the number of findings in the latest file versions, from
+// the summary table.  This does not read the reports themselves.
+bool ReportSummary(Database &, SummaryKind::Enum, SummaryCallback);
+
 // Returns carets for the source text, starting at column.  Leading
 // characters in the text are replaced with spaces, except for tabs,
 // which are left as-is, to preserve indentation.
@@ -23,6 +23,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -52,7 +54,7 @@ TemporaryErrorCode(int code)
 }
 
 Database::Database()
-  : Ptr(NULL)
+  : Ptr(NULL), RetryCount(0)
 {
 }
 
@@ -78,10 +80,9 @@ namespace {
   }
 
   bool
-  createOrOpen(Database &DB, const char *path, bool create)
+  openWithFlags(Database &DB, const char *path, int flags)
   {
     sqlite3 *db;
-    int flags = (create ? SQLITE_OPEN_CREATE : 0) | SQLITE_OPEN_READWRITE;
     int ret = sqlite3_open_v2(path, &db, flags, NULL);
     if (db == NULL) {
       DB.ErrorMessage = "out of memory";
@@ -98,7 +99,15 @@ namespace {
       return false;
     }
     DB.Ptr = db;
-    return DB.Execute("PRAGMA foreign_keys = ON;");
+    return true;
+  }
+
+  bool
+  createOrOpen(Database &DB, const char *path, bool create)
+  {
+    int flags = (create ? SQLITE_OPEN_CREATE : 0) | SQLITE_OPEN_READWRITE;
+    return openWithFlags(DB, path, flags)
+      && DB.Execute("PRAGMA foreign_keys = ON;");
   }
 }
 
@@ -114,15 +123,53 @@ Database::Create(const char *path)
   return createOrOpen(*this, path, true);
 }
 
+bool
+Database::OpenReadOnly(const char *path)
+{
+  // In WAL mode, readers do not block the writer, and the writer
+  // does not block readers.  Reading through a memory mapping
+  // avoids copying the pages into the page cache of the connection.
+  return openWithFlags(*this, path, SQLITE_OPEN_READONLY)
+    && Execute("PRAGMA query_only = ON;"
+	       "PRAGMA mmap_size = 1073741824;");
+}
+
+bool
+Database::OpenReadOnly()
+{
+  std::string path;
+  if (!Locate(path, ErrorMessage)) {
+    return false;
+  }
+  return OpenReadOnly(path.c_str());
+}
+
 bool
 Database::Open()
 {
+  std::string path;
+  if (!Locate(path, ErrorMessage)) {
+    return false;
+  }
+  return Open(path.c_str());
+}
+
+bool
+Database::Locate(std::string &result, std::string &errorMessage)
+{
+  // Avoids the directory search for each compiler invocation.
+  const char *env = getenv("HTCONDOR_ANALYZER_DATABASE");
+  if (env != NULL && *env != '\0') {
+    result = env;
+    return true;
+  }
+
   // getcwd() is not thread-safe, so we do not use it.
   std::string path;
   if (!ResolvePath(".", path)) {
     int code = errno;
-    ErrorMessage = "could not resolve current directory: ";
-    AppendErrorString(ErrorMessage, code);
+    errorMessage = "could not resolve current directory: ";
+    AppendErrorString(errorMessage, code);
     return false;
   }
   std::string pathCopy = path;
@@ -132,17 +179,18 @@ Database::Open()
     path += '/';
     path += FileName;
     if (access(path.c_str(), F_OK) == 0) {
-      return Open(path.c_str());
+      result = path;
+      return true;
     }
     path.resize(oldSize);
     removeTrailingComponent(path);
   } while (path.size() > 1);
-  ErrorMessage = "could not find ";
-  ErrorMessage += FileName;
-  ErrorMessage += " in ";
-  ErrorMessage += pathCopy;
-  ErrorMessage += " or its parent directories";
-  return NULL;
+  errorMessage = "could not find ";
+  errorMessage += FileName;
+  errorMessage += " in ";
+  errorMessage += pathCopy;
+  errorMessage += " or its parent directories";
+  return false;
 }
 
 bool
@@ -186,6 +234,23 @@ Database::Execute(const char *sql)
   return true;
 }
 
+bool
+Database::HasColumn(const char *Table, const char *Column)
+{
+  Statement Columns;
+  if (!Columns.Prepare(*this, (std::string("PRAGMA table_info(")
+			       + Table + ")").c_str())) {
+    return false;
+  }
+  while (sqlite3_step(Columns.Ptr) == SQLITE_ROW) {
+    const char *Name = (const char *)sqlite3_column_text(Columns.Ptr, 1);
+    if (Name != NULL && strcmp(Name, Column) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void
 Database::SetError(const char *Context)
 {
@@ -233,6 +298,7 @@ Database::Transact(std::tr1::function<TransactionResult::Enum()> runner)
   for (unsigned Retries = 0; Retries < MaxRetries; ++Retries) {
     if (Retries > 0) {
       // Randomized exponential back-off.
+      ++RetryCount;
       RandomSleep(100 << Retries);
     }
     sqlite3_reset(stmtBegin.Ptr);
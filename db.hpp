@@ -42,16 +42,32 @@ struct Database {
 
   sqlite3 *Ptr;
   std::string ErrorMessage;
+  unsigned RetryCount;		// transactions retried by Transact
   Database();
   ~Database();
 
   bool Open(const char *Path);
   bool Create(const char *Path);
-  bool Open(); // from current directory or its parents
+  bool Open(); // see Locate
+
+  // Opens the database for reading only.  Readers should run their
+  // queries in a single transaction (BEGIN ... COMMIT), so that they
+  // see one snapshot while the plugin commits new results.
+  bool OpenReadOnly(const char *Path);
+  bool OpenReadOnly(); // see Locate
+
+  // Determines the path of the database file: the value of the
+  // HTCONDOR_ANALYZER_DATABASE environment variable if it is set, or
+  // else the first FileName found in the current directory or its
+  // parents.
+  static bool Locate(std::string &Path, std::string &ErrorMessage);
   bool Close();
 
   bool Execute(const char *);
 
+  // Returns true if Table exists and has a column named Column.
+  bool HasColumn(const char *Table, const char *Column);
+
   // Sets ErrorMessage from the database object.
   void SetError(const char *Context=NULL);
 
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Writes the latest file versions in the database, with their
+// reports, to a bundle file, which can be merged into another
+// database with the import tool.
+
+#include "db.hpp"
+#include "db-bundle.hpp"
+
+#include <getopt.h>
+#include <stdio.h>
+
+static void
+Usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [-d DATABASE] BUNDLE\n", progname);
+}
+
+static const struct option LongOptions[] = {
+  {"database", required_argument, NULL, 'd'},
+  {"verbose", no_argument, NULL, 'v'},
+  {NULL, 0, NULL, 0}
+};
+
+int
+main(int argc, char **argv)
+{
+  const char *database = NULL;
+  bool verbose = false;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "d:v", LongOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'd':
+      database = optarg;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind + 1 != argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+  const char *bundle = argv[optind];
+
+  Database DB;
+  if (!(database != NULL ? DB.OpenReadOnly(database) : DB.OpenReadOnly())) {
+    fprintf(stderr, "error: could not open database: %s\n",
+	    DB.ErrorMessage.c_str());
+    return 1;
+  }
+
+  BundleStatistics stats;
+  if (!ExportBundle(DB, bundle, stats)) {
+    fprintf(stderr, "error: %s: %s\n", bundle, DB.ErrorMessage.c_str());
+    return 1;
+  }
+  if (verbose) {
+    fprintf(stderr, "%s: %llu files, %llu reports\n",
+	    bundle, stats.Files, stats.Reports);
+  }
+  return 0;
+}
@@ -19,6 +19,12 @@
 #include "file.hpp"
 #include "util.hpp"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 bool
 ResolvePath(const char *path, std::string &result)
 {
@@ -31,3 +37,83 @@ ResolvePath(const char *path, std::string &result)
   return false;
 }
 
+bool
+HashFileContents(const char *path, unsigned long long &hash)
+{
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int code = errno;
+    close(fd);
+    errno = code;
+    return false;
+  }
+  if (st.st_size == 0) {
+    // mmap rejects empty mappings.
+    close(fd);
+    hash = FastHash("", 0);
+    return true;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  int code = errno;
+  close(fd);
+  if (data == MAP_FAILED) {
+    errno = code;
+    return false;
+  }
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  hash = FastHash(data, st.st_size);
+  munmap(data, st.st_size);
+  return true;
+}
+
+PathPrefixSet::PathPrefixSet()
+  : Nodes(1)
+{
+}
+
+void
+PathPrefixSet::Add(const std::string &Prefix)
+{
+  std::string::size_type Length = Prefix.size();
+  while (Length > 0 && Prefix[Length - 1] == '/') {
+    --Length;
+  }
+  unsigned Current = 0;
+  for (std::string::size_type i = 0; i < Length; ++i) {
+    std::map<char, unsigned>::iterator p =
+      Nodes[Current].Children.find(Prefix[i]);
+    if (p == Nodes[Current].Children.end()) {
+      unsigned Next = Nodes.size();
+      Nodes[Current].Children[Prefix[i]] = Next;
+      Nodes.push_back(Node());
+      Current = Next;
+    } else {
+      Current = p->second;
+    }
+  }
+  Nodes[Current].Terminal = true;
+}
+
+bool
+PathPrefixSet::Matches(const std::string &Path) const
+{
+  unsigned Current = 0;
+  for (std::string::size_type i = 0; ; ++i) {
+    if (Nodes[Current].Terminal && (i == Path.size() || Path[i] == '/')) {
+      return true;
+    }
+    if (i == Path.size()) {
+      return false;
+    }
+    std::map<char, unsigned>::const_iterator p =
+      Nodes[Current].Children.find(Path[i]);
+    if (p == Nodes[Current].Children.end()) {
+      return false;
+    }
+    Current = p->second;
+  }
+}
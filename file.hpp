@@ -18,7 +18,40 @@
 
 #pragma once
 
+#include <map>
 #include <string>
+#include <vector>
 
 // Determines the canonical name for the path.
 bool ResolvePath(const char *path, std::string &result);
+
+// Computes FastHash over the contents of the file, which is mapped
+// into memory.  Returns false and sets errno if the file cannot be
+// read.
+bool HashFileContents(const char *path, unsigned long long &hash);
+
+// A set of path prefixes, stored as a trie.  A prefix matches the
+// paths which are equal to it or continue with a slash, so
+// "/usr/include" matches "/usr/include/stdio.h", but not
+// "/usr/include2".
+class PathPrefixSet {
+public:
+  PathPrefixSet();
+
+  // Adds the prefix.  Trailing slashes are ignored.
+  void Add(const std::string &Prefix);
+
+  bool empty() const { return Nodes.size() == 1 && !Nodes[0].Terminal; }
+
+  // Returns true if Path is under one of the prefixes.
+  bool Matches(const std::string &Path) const;
+
+private:
+  struct Node {
+    std::map<char, unsigned> Children; // indexes into Nodes
+    bool Terminal;		       // a prefix ends here
+
+    Node() : Terminal(false) { }
+  };
+  std::vector<Node> Nodes;	// Nodes[0] is the root
+};
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Findings file format.  All integers are 32-bit, in the byte order
+// of the writer (recorded in the header).  The arrays follow each
+// other without padding, so their positions follow from the counts
+// in the header.
+//
+//   header      magic "HTCAFND2", byte order mark 0x01020304, and the
+//               number of strings, files and reports, and the size
+//               of the string data, all as in struct Header
+//   strings     offset of each string in the string data; the
+//               strings are sorted, so that string IDs compare like
+//               the strings
+//   file paths  string ID of the path of each file, in path order
+//   file index  index of the first report of each file, and the
+//               number of reports as the last element
+//   lines       line of each report
+//   columns     column of each report
+//   tools       string ID of the tool of each report
+//   messages    string ID of the message of each report
+//   occurrences number of findings each report stands for (see
+//               ReportCallback)
+//   string data null-terminated strings
+//
+// The reports of a file are in the order of Report.
+
+#include "findings.hpp"
+#include "db.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  const char Magic[8] = {'H', 'T', 'C', 'A', 'F', 'N', 'D', '2'};
+  const uint32_t ByteOrderMark = 0x01020304;
+
+  struct Header {
+    char Magic[8];
+    uint32_t ByteOrder;
+    uint32_t Strings;
+    uint32_t Files;
+    uint32_t Reports;
+    uint32_t StringBytes;
+    uint32_t Reserved;
+  };
+
+  // Total size of a file with the counts in the header.
+  unsigned long long
+  FileSize(const Header &H)
+  {
+    return sizeof(Header)
+      + 4ULL * (H.Strings + 2ULL * H.Files + 1 + 5ULL * H.Reports)
+      + H.StringBytes;
+  }
+
+  // Findings collected by WriteFindingsFile, with temporary string
+  // IDs in the order the strings are first seen.
+  class Collector {
+    typedef std::map<std::string, uint32_t> StringMap;
+    StringMap Strings;
+    std::vector<StringMap::iterator> ByID;
+  public:
+    std::vector<uint32_t> FilePaths, FileIndex;
+    std::vector<uint32_t> Lines, Columns, Tools, Messages, Occurrences;
+    bool Overflow;
+
+    Collector()
+      : Overflow(false)
+    {
+    }
+
+    uint32_t Intern(const char *Str)
+    {
+      std::pair<StringMap::iterator, bool> Result
+	= Strings.insert(std::make_pair(std::string(Str), ByID.size()));
+      if (Result.second) {
+	ByID.push_back(Result.first);
+      }
+      return Result.first->second;
+    }
+
+    bool Add(const char *Path, unsigned Line, unsigned Column,
+	     const char *Tool, const char *Message, unsigned Count)
+    {
+      if (Lines.size() >= UINT32_MAX - 1) {
+	Overflow = true;
+	return false;
+      }
+      // Report passes the files in path order, each file once.
+      uint32_t PathID = Intern(Path);
+      if (FilePaths.empty() || FilePaths.back() != PathID) {
+	FilePaths.push_back(PathID);
+	FileIndex.push_back(Lines.size());
+      }
+      Lines.push_back(Line);
+      Columns.push_back(Column);
+      Tools.push_back(Intern(Tool));
+      Messages.push_back(Intern(Message));
+      Occurrences.push_back(Count);
+      return true;
+    }
+
+    // Replaces the temporary string IDs with the ranks of the
+    // strings, and returns the string offsets and data.
+    bool Finish(std::vector<uint32_t> &Offsets, std::string &Data)
+    {
+      std::vector<uint32_t> Rank(ByID.size());
+      uint32_t Next = 0;
+      for (StringMap::iterator p = Strings.begin(), end = Strings.end();
+	   p != end; ++p) {
+	Rank[p->second] = Next++;
+	Offsets.push_back(Data.size());
+	Data += p->first;
+	Data += '\0';
+	if (Data.size() >= UINT32_MAX) {
+	  return false;
+	}
+      }
+      Strings.clear();
+      ByID.clear();
+      Renumber(FilePaths, Rank);
+      Renumber(Tools, Rank);
+      Renumber(Messages, Rank);
+      FileIndex.push_back(Lines.size());
+      return true;
+    }
+
+  private:
+    static void Renumber(std::vector<uint32_t> &IDs,
+			 const std::vector<uint32_t> &Rank)
+    {
+      for (std::vector<uint32_t>::iterator p = IDs.begin(), end = IDs.end();
+	   p != end; ++p) {
+	*p = Rank[*p];
+      }
+    }
+  };
+
+  bool
+  WriteArray(FILE *out, const std::vector<uint32_t> &Array)
+  {
+    return Array.empty()
+      || fwrite(&Array.front(), sizeof(uint32_t), Array.size(), out)
+      == Array.size();
+  }
+
+  // Returns the string with the ID, or NULL if the ID, which comes
+  // from the file, is out of range.
+  const char *
+  StringAt(const Header &H, const uint32_t *Offsets, const char *Data,
+	   uint32_t ID)
+  {
+    if (ID < H.Strings && Offsets[ID] < H.StringBytes) {
+      return Data + Offsets[ID];
+    }
+    return NULL;
+  }
+
+  // Returns the ID of the string, or Count if it is not in the
+  // sorted table.
+  uint32_t
+  FindString(const char *Data, const uint32_t *Offsets, uint32_t Count,
+	     uint32_t StringBytes, const char *Str)
+  {
+    uint32_t Low = 0, High = Count;
+    while (Low < High) {
+      uint32_t Middle = Low + (High - Low) / 2;
+      if (Offsets[Middle] >= StringBytes) {
+	return Count;
+      }
+      int Cmp = strcmp(Data + Offsets[Middle], Str);
+      if (Cmp == 0) {
+	return Middle;
+      }
+      if (Cmp < 0) {
+	Low = Middle + 1;
+      } else {
+	High = Middle;
+      }
+    }
+    return Count;
+  }
+}
+
+bool
+WriteFindingsFile(Database &DB, const ReportFilter &Filter, const char *Path,
+		  unsigned long long &Reports, unsigned long long &Skipped)
+{
+  using namespace std::tr1::placeholders;
+  Collector C;
+  Skipped = 0;
+  if (!::Report(DB, Filter, std::tr1::bind(&Collector::Add, &C,
+					   _1, _2, _3, _4, _5, _6),
+		&Skipped)) {
+    DB.ErrorMessage = "could not read the findings";
+    return false;
+  }
+  std::vector<uint32_t> Offsets;
+  std::string Data;
+  if (C.Overflow || !C.Finish(Offsets, Data)) {
+    DB.ErrorMessage = "too many findings";
+    return false;
+  }
+  Reports = C.Lines.size();
+
+  Header H;
+  memset(&H, 0, sizeof(H));
+  memcpy(H.Magic, Magic, sizeof(Magic));
+  H.ByteOrder = ByteOrderMark;
+  H.Strings = Offsets.size();
+  H.Files = C.FilePaths.size();
+  H.Reports = Reports;
+  H.StringBytes = Data.size();
+
+  // The new file replaces the old one only when it is complete.
+  std::string Temporary(Path);
+  Temporary += ".tmp";
+  FILE *out = fopen(Temporary.c_str(), "wb");
+  if (out == NULL) {
+    DB.ErrorMessage.clear();
+    AppendErrorString(DB.ErrorMessage, errno);
+    return false;
+  }
+  bool Result = fwrite(&H, sizeof(H), 1, out) == 1
+    && WriteArray(out, Offsets)
+    && WriteArray(out, C.FilePaths)
+    && WriteArray(out, C.FileIndex)
+    && WriteArray(out, C.Lines)
+    && WriteArray(out, C.Columns)
+    && WriteArray(out, C.Tools)
+    && WriteArray(out, C.Messages)
+    && WriteArray(out, C.Occurrences)
+    && fwrite(Data.data(), 1, Data.size(), out) == Data.size();
+  if (fclose(out) != 0) {
+    Result = false;
+  }
+  if (Result && rename(Temporary.c_str(), Path) != 0) {
+    Result = false;
+  }
+  if (!Result) {
+    DB.ErrorMessage.clear();
+    AppendErrorString(DB.ErrorMessage, errno);
+    unlink(Temporary.c_str());
+  }
+  return Result;
+}
+
+FindingsFile::FindingsFile()
+  : Base(NULL), Size(0)
+{
+}
+
+FindingsFile::~FindingsFile()
+{
+  if (Base != NULL) {
+    munmap(const_cast<char *>(Base), Size);
+  }
+}
+
+bool
+FindingsFile::Open(const char *Path)
+{
+  int fd = open(Path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ErrorMessage.clear();
+    AppendErrorString(ErrorMessage, errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ErrorMessage.clear();
+    AppendErrorString(ErrorMessage, errno);
+    close(fd);
+    return false;
+  }
+  if (st.st_size < (off_t)sizeof(Header)) {
+    ErrorMessage = "not a findings file";
+    close(fd);
+    return false;
+  }
+  void *Mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  int code = errno;
+  close(fd);
+  if (Mapping == MAP_FAILED) {
+    ErrorMessage.clear();
+    AppendErrorString(ErrorMessage, code);
+    return false;
+  }
+  Base = static_cast<const char *>(Mapping);
+  Size = st.st_size;
+
+  const Header &H(*reinterpret_cast<const Header *>(Base));
+  if (memcmp(H.Magic, Magic, sizeof(Magic) - 1) != 0) {
+    ErrorMessage = "not a findings file";
+    return false;
+  }
+  if (H.Magic[sizeof(Magic) - 1] != Magic[sizeof(Magic) - 1]) {
+    ErrorMessage = "unsupported findings file version";
+    return false;
+  }
+  if (H.ByteOrder != ByteOrderMark) {
+    ErrorMessage = "findings file written with a different byte order";
+    return false;
+  }
+  if (FileSize(H) != Size
+      || (H.StringBytes > 0 && Base[Size - 1] != '\0')) {
+    ErrorMessage = "findings file is truncated or corrupted";
+    return false;
+  }
+  return true;
+}
+
+bool
+FindingsFile::Report(const ReportFilter &Filter, ReportCallback CB)
+{
+  if (Base == NULL) {
+    ErrorMessage = "findings file is not open";
+    return false;
+  }
+  if (Filter.AnalyzedSince != 0) {
+    ErrorMessage = "findings files do not record analysis times";
+    return false;
+  }
+  const Header &H(*reinterpret_cast<const Header *>(Base));
+  const uint32_t *Offsets
+    = reinterpret_cast<const uint32_t *>(Base + sizeof(Header));
+  const uint32_t *FilePaths = Offsets + H.Strings;
+  const uint32_t *FileIndex = FilePaths + H.Files;
+  const uint32_t *Lines = FileIndex + H.Files + 1;
+  const uint32_t *Columns = Lines + H.Reports;
+  const uint32_t *Tools = Columns + H.Reports;
+  const uint32_t *Messages = Tools + H.Reports;
+  const uint32_t *Occurrences = Messages + H.Reports;
+  const char *Data = reinterpret_cast<const char *>(Occurrences + H.Reports);
+
+  // Tools which do not occur in the file cannot match.
+  std::vector<uint32_t> ToolIDs;
+  for (std::vector<std::string>::const_iterator p = Filter.Tools.begin(),
+	 end = Filter.Tools.end(); p != end; ++p) {
+    uint32_t ID = FindString(Data, Offsets, H.Strings, H.StringBytes,
+			     p->c_str());
+    if (ID != H.Strings) {
+      ToolIDs.push_back(ID);
+    }
+  }
+  if (!Filter.Tools.empty() && ToolIDs.empty()) {
+    return true;
+  }
+
+  for (uint32_t File = 0; File < H.Files; ++File) {
+    const char *Path = StringAt(H, Offsets, Data, FilePaths[File]);
+    uint32_t First = FileIndex[File];
+    uint32_t Last = FileIndex[File + 1];
+    if (Path == NULL || First > Last || Last > H.Reports) {
+      ErrorMessage = "findings file is corrupted";
+      return false;
+    }
+    if (!Filter.PathGlob.empty()
+	&& sqlite3_strglob(Filter.PathGlob.c_str(), Path) != 0) {
+      continue;
+    }
+    for (uint32_t i = First; i < Last; ++i) {
+      if (!ToolIDs.empty()
+	  && std::find(ToolIDs.begin(), ToolIDs.end(), Tools[i])
+	  == ToolIDs.end()) {
+	continue;
+      }
+      const char *Tool = StringAt(H, Offsets, Data, Tools[i]);
+      const char *Message = StringAt(H, Offsets, Data, Messages[i]);
+      if (Tool == NULL || Message == NULL) {
+	ErrorMessage = "findings file is corrupted";
+	return false;
+      }
+      if (!CB(Path, Lines[i], Columns[i], Tool, Message, Occurrences[i])) {
+	break;
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "db-report.hpp"
+
+#include <string>
+
+#include <stddef.h>
+
+class Database;
+
+// A findings file holds the findings which Report returns, in a form
+// which is used directly after mapping the file into memory, without
+// decoding.  It is meant for copying the results of a build to
+// machines which only query them.
+
+// Writes the findings matching the filter to a new findings file at
+// Path, replacing the file atomically.  Reports receives the number
+// of findings, and Skipped the number of files which were left out
+// because they are missing on disk or have changed since their
+// analysis (see Report).  On failure, the error message is in
+// DB.ErrorMessage.
+bool WriteFindingsFile(Database &DB, const ReportFilter &, const char *Path,
+		       unsigned long long &Reports,
+		       unsigned long long &Skipped);
+
+// A findings file mapped into memory.
+class FindingsFile {
+public:
+  std::string ErrorMessage;
+
+  FindingsFile();
+  ~FindingsFile();
+
+  // Maps the file at Path into memory.  Only the header and the
+  // size of the file are checked.
+  bool Open(const char *Path);
+
+  // Like Report(Database &, const ReportFilter &, ReportCallback).
+  // The file does not record analysis times, so the filter must not
+  // set AnalyzedSince.  Files are not compared with the versions on
+  // disk.
+  bool Report(const ReportFilter &, ReportCallback);
+
+private:
+  const char *Base;
+  size_t Size;
+
+  FindingsFile(const FindingsFile &); // not implemented
+  FindingsFile &operator=(const FindingsFile &); // not implemented
+};
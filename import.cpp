@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Merges bundle files written by the export tool into the database.
+// File versions which are already present are skipped.  With
+// "-r OLD=NEW", paths starting with OLD are changed to start with NEW
+// instead, so that the results of builds in different directories
+// can be combined.
+
+#include "db.hpp"
+#include "db-bundle.hpp"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+
+static void
+Usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [-v] [-d DATABASE] [-r OLD=NEW]... "
+	  "BUNDLE...\n", progname);
+}
+
+static const struct option LongOptions[] = {
+  {"database", required_argument, NULL, 'd'},
+  {"remap", required_argument, NULL, 'r'},
+  {"verbose", no_argument, NULL, 'v'},
+  {NULL, 0, NULL, 0}
+};
+
+int
+main(int argc, char **argv)
+{
+  const char *database = NULL;
+  PathRemapList remaps;
+  bool verbose = false;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "d:r:v", LongOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'd':
+      database = optarg;
+      break;
+    case 'r':
+      {
+	const char *eq = strchr(optarg, '=');
+	if (eq == NULL || eq == optarg) {
+	  fprintf(stderr, "error: invalid remapping: %s\n", optarg);
+	  return 1;
+	}
+	remaps.push_back(std::make_pair(std::string(optarg, eq - optarg),
+					std::string(eq + 1)));
+      }
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind == argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  Database DB;
+  if (!(database != NULL ? DB.Open(database) : DB.Open())) {
+    fprintf(stderr, "error: could not open database: %s\n",
+	    DB.ErrorMessage.c_str());
+    return 1;
+  }
+
+  for (int i = optind; i < argc; ++i) {
+    BundleStatistics stats;
+    if (!ImportBundle(DB, argv[i], remaps, stats)) {
+      fprintf(stderr, "error: %s: %s\n", argv[i], DB.ErrorMessage.c_str());
+      return 1;
+    }
+    if (verbose) {
+      fprintf(stderr, "%s: %llu files (%llu already present), "
+	      "%llu reports imported\n",
+	      argv[i], stats.Files, stats.Duplicates, stats.Reports);
+    }
+  }
+  return 0;
+}
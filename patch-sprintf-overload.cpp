@@ -22,7 +22,6 @@
 
 #include <getopt.h>
 #include <stdio.h>
-#include <string.h>
 
 #include <string>
 #include <map>
@@ -46,12 +45,8 @@ static bool
 Callback(const Options &options, bool &failed,
 	 FilesMap &Files,
 	 const char *path, unsigned line, unsigned column,
-	 const char *tool, const char *message)
+	 const char *tool, const char *message, unsigned occurrences)
 {
-  if (strcmp(tool, "sprintf-overload") != 0) {
-    return true;
-  }
-  
   FilesMap::iterator Editor = Files.find(path);
   if (Editor == Files.end()) {
     if (!Editor->second.Read(path)) {
@@ -121,24 +116,36 @@ main(int argc, char **argv)
 
   Database DB;
   if (optind < argc) {
-    if (!DB.Open(argv[optind])) {
+    if (!DB.OpenReadOnly(argv[optind])) {
       fprintf(stderr, "error: could not open database: %s\n",
 	      DB.ErrorMessage.c_str());
       return 1;
     }
   } else {
-    if (!DB.Open()) {
+    if (!DB.OpenReadOnly()) {
       fprintf(stderr, "error: could not open database: %s\n",
 	      DB.ErrorMessage.c_str());
       return 1;
     }
   }
 
+  // The queries read a single snapshot of the database, while the
+  // plugin may commit new results.
+  if (!DB.Execute("BEGIN")) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
+
+  // Only the sprintf overloads are patched.
+  ReportFilter filter;
+  filter.Tools.push_back("sprintf-overload");
+
   std::map<std::string, LineEditor> Files;
   bool failed = false;
   using namespace std::tr1::placeholders;
-  bool ok = Report(DB, std::tr1::bind(&Callback, options, failed, Files,
-				      _1, _2, _3, _4, _5));
+  bool ok = Report(DB, filter,
+		   std::tr1::bind(&Callback, options, failed, Files,
+				  _1, _2, _3, _4, _5, _6));
   if (ok && !failed) {
     if (!options.dry_run) {
       for (FilesMap::iterator p = Files.begin(),
@@ -44,10 +44,15 @@
 // * Local variables which are declared static and not const are
 //   reported as "static-local".
 //
+// With the plugin argument "aggregate=TOOL", the findings of TOOL
+// are counted per function and stored as a single row, located at
+// the function, whose occurrences column holds the count.
+//
 // The results are stored in an SQLite database
 // "htcondor-analyzer.sqlite", which must be located in a parent
-// directory.  This database has to be created manually, using the
-// ./create-db utility.
+// directory (or be named by the HTCONDOR_ANALYZER_DATABASE
+// environment variable or the db= plugin argument).  This database
+// has to be created manually, using the ./create-db utility.
 //
 // Clang has to be invoked this way:
 //
@@ -56,729 +61,92 @@
 //
 // Or use the ./cxx wrapper in this directory.
 //
+// Besides plugin.so, which runs all checks, the Makefile builds
+// variants with subsets of the checks: plugin-security.so,
+// plugin-api.so and plugin-perf.so.  The checkers and the checker
+// sets are defined in checkers.hpp.
+//
 // Florian Weimer / Red Hat Product Security Team
 
-#include "db-file.hpp"
-
-#include <sstream>
-#include <memory>
-#include <map>
+#include "checkers.hpp"
 
 #include "clang/Frontend/FrontendPluginRegistry.h"
-#include "clang/AST/ASTConsumer.h"
-#include "clang/AST/RecursiveASTVisitor.h"
-#include "clang/AST/AST.h"
-#include "clang/Basic/SourceManager.h"
-#include "clang/Basic/FileManager.h"
-#include "clang/Frontend/CompilerInstance.h"
-#include "clang/Basic/Builtins.h"
-
-#include "llvm/Support/raw_ostream.h"
-#include "llvm/Support/raw_os_ostream.h"
-
-using namespace clang;
 
 namespace {
 
-void
-FatalError(DiagnosticsEngine &D, const std::string &message)
-{
-  unsigned Fatal = D.getCustomDiagID
-    (DiagnosticsEngine::Fatal, "(htcondor-analysis) " + message);
-  D.Report(Fatal);
-}
-
-void
-FatalError(DiagnosticsEngine &D, SourceLocation Pos, const std::string &message)
-{
-  unsigned Fatal = D.getCustomDiagID
-    (DiagnosticsEngine::Fatal, "(htcondor-analysis) " + message);
-  D.Report(Pos, Fatal);
-}
-
-template <class Visitor>
-class ConsumerFromVisitor : public ASTConsumer {
-  std::tr1::shared_ptr<FileIdentificationDatabase> FileDB;
-
-public:
-  ConsumerFromVisitor(std::tr1::shared_ptr<FileIdentificationDatabase> DB)
-    : FileDB(DB)
-  {
-  }
-
-  virtual void HandleTranslationUnit(ASTContext &Context) {
-    if (Context.getDiagnostics().hasErrorOccurred()) {
-      return;
-    }
-    RecordFiles(Context);
-    Visitor visitor(FileDB, Context);
-    visitor.TraverseDecl(Context.getTranslationUnitDecl());
-    if (Context.getDiagnostics().hasErrorOccurred()) {
-      return;
-    }
-    if (!FileDB->Commit()) {
-      FatalError(Context.getDiagnostics(),
-		 "commit: " + FileDB->ErrorMessage());
-    }
-  }
-
-  void RecordFiles(ASTContext &Context)
-  {
-    // TODO: Preload entries to support AST dumps/pre-compiled
-    // headers.
-    const SourceManager &SrcMan = Context.getSourceManager();
-    for (SourceManager::fileinfo_iterator FI = SrcMan.fileinfo_begin(),
-	   end = SrcMan.fileinfo_end(); FI != end; ++FI) {
-      SrcMgr::ContentCache *CCache = FI->second;
-      const FileEntry *FEntry = CCache->ContentsEntry;
-      if (!FEntry) {
-	FEntry = CCache->OrigEntry;
-      }
-      if (!FEntry) {
-	continue;
-      }
-      FileDB->MarkForProcessing(FEntry->getName());
-    }
-  }
-};
-
-
-
-//////////////////////////////////////////////////////////////////////
-// OuterVisitor
+#ifndef HTCONDOR_ANALYSIS_CHECKERS
+#define HTCONDOR_ANALYSIS_CHECKERS AllCheckers
+#endif
 
-class OuterVisitor : public RecursiveASTVisitor<OuterVisitor> {
-  ASTContext &Context;
+class Action : public PluginASTAction {
   std::tr1::shared_ptr<FileIdentificationDatabase> FileDB;
+  std::tr1::shared_ptr<CheckerOptions> Options;
+  unsigned Jobs;
 
 public:
-  OuterVisitor(std::tr1::shared_ptr<FileIdentificationDatabase> DB, ASTContext &C)
-    : Context(C), FileDB(DB)
-  {
-  }
-
-  bool shouldVisitTemplateInstantiations() const { return true; }
-
-  bool VisitCXXMemberCallExpr(CXXMemberCallExpr *Expr)
-  {
-    ProcessSizeofCallExpr(Expr);
-    ProcessRegisterCommand(Expr);
-    return true;
-  }
-
-  bool VisitCallExpr(CallExpr *Expr)
-  {
-    ProcessSizeofCallExpr(Expr);
-    ProcessSprintf(Expr);
-    ProcessStrcpy(Expr);
-    ProcessAlloca(Expr);
-    return true;
-  }
-
-  bool VisitCXXOperatorCallExpr(CXXOperatorCallExpr *Expr)
-  {
-    ProcessMyStringOperator(Expr);
-    StandardLibraryProcessSubscript(Expr);
-    return true;
-  }
-
-  bool VisitUnaryOperator(UnaryOperator *Expr)
-  {
-    PointerArithProcessUnaryOperator(Expr);
-    return true;
-  }
-
-  bool VisitBinaryOperator(BinaryOperator *Expr)
-  {
-    PointerArithProcessBinaryOperator(Expr);
-    return true;
-  }
-
-  bool VisitArraySubscriptExpr(ArraySubscriptExpr *Expr)
-  {
-    PointerArithProcessSubscript(Expr);
-    return true;
-  }
-
-  bool VisitVarDecl(VarDecl *Decl)
-  {
-    ProcessStaticLocal(Decl);
-    return true;
-  }
-
-private:
-  ////////////////////////////////////////////////////////////////////
-  // Register_Command
-
-  void ProcessRegisterCommand(CXXMemberCallExpr *Expr)
-  {
-    if (const CXXMethodDecl *MethodDecl = getMethodDecl(Expr)) {
-      std::string MethodName(MethodDecl->getNameAsString());
-      if (MethodName == "Register_Command"
-	  || MethodName == "Register_CommandWithPayload") {
-	unsigned numArgs = Expr->getNumArgs();
-	if (numArgs < 5 ) {
-	  Report(Expr->getExprLoc(), "Register_Command",
-		 "call without enough arguments");
-	  return;
-	}
-
-	llvm::APSInt command;
-	if (!Expr->getArg(0)->EvaluateAsInt(command, Context)) {
-	  Report(Expr->getExprLoc(), "Register_Command",
-		 "call with non-constant command");
-	  return;
-	}
-
-	llvm::APSInt perm;	// default is ALLOW
-	if (numArgs >= 6) {
-	  if (!Expr->getArg(5)->EvaluateAsInt(perm, Context)) {
-	    Report(Expr->getExprLoc(), "Register_Command",
-		   "call with non-constant perm");
-	    return;
-	  }
-	}
-
-	bool forceAuthentication = false;
-	if (numArgs >= 8) {
-	  if (!Expr->getArg(7)->EvaluateAsBooleanCondition
-	      (forceAuthentication, Context)
-	      && !Expr->getArg(7)->isDefaultArgument()) {
-	    Report(Expr->getExprLoc(), "Register_Command",
-		   "call with non-constant force_authentication");
-	    return;
-	  }
-	}
-
-	std::ostringstream ostr;
-	{
-	  llvm::raw_os_ostream message(ostr);
-	  message << MethodName
-		  << " command=" << command << " perm=" << perm
-		  << " auth=" << (forceAuthentication ? "true" : "false");
-	}
-	Report(Expr->getExprLoc(), "Register_Command", ostr.str());
-      } else if (isSprintfName(MethodName)) {
-	ProcessSprintfMemberCall(Expr, MethodDecl, MethodName);
-      }
-    }
-  }
-
-  ////////////////////////////////////////////////////////////////////
-  // sprintf
-
-  struct SprintfTarget {
-    typedef enum {
-      None, CharPtr, MyString, StdString, Other
-    } Enum;
-  private:
-    SprintfTarget();
-    ~SprintfTarget();
-  };
-
-  void ProcessSprintf(CallExpr *Expr)
-  {
-    if (FunctionDecl *Decl = Expr->getDirectCallee()) {
-      std::string FunctionName = Decl->getNameAsString();
-      if (isSprintfName(FunctionName)) {
-	SprintfTarget::Enum Target = getSprintfTarget(Decl);
-	switch (Target) {
-	case SprintfTarget::None:
-	  break;
-	case SprintfTarget::CharPtr:
-	  Report(Expr->getExprLoc(), "sprintf", FunctionName);
-	  break;
-	case SprintfTarget::MyString:
-	  Report(Expr->getExprLoc(), "sprintf-overload",
-		 FunctionName + "(MyString)");
-	  break;
-	case SprintfTarget::StdString:
-	  Report(Expr->getExprLoc(), "sprintf-overload",
-		 FunctionName + "(std::string)");
-	  break;
-	case SprintfTarget::Other:
-	  {
-	    std::ostringstream ostr;
-	    ostr << FunctionName << '(';
-	    {
-	      llvm::raw_os_ostream OS(ostr);
-#if 0
-	      std::unique_ptr<ASTConsumer> Printer
-		(Context.CreateASTPrinter(OS));
-	      Printer->TraverseParamVarDecl(*Decl->param_begin);
-#else
-	      OS << "<unknown>";
-#endif
-	    }
-	    ostr << ')';
-	    Report(Expr->getExprLoc(), "sprintf-overload", ostr.str());
-	  }
-	  break;
-	}
-      }
-    }
-  }
-
-  void ProcessSprintfMemberCall(const CXXMemberCallExpr *Expr,
-				const CXXMethodDecl *Decl,
-				const std::string &MethodName)
-  {
-    Report(Expr->getCallee()->getExprLoc(),
-	   "sprintf-overload", MethodName + "(" +
-	   Decl->getParent()->getQualifiedNameAsString() + ")");
-  }
-
-  static bool isSprintfName(const std::string &Name) {
-    return Name == "sprintf" || Name == "vsprintf";
-  }
-
-  static SprintfTarget::Enum getSprintfTarget(FunctionDecl *Decl) {
-    if (Decl->getNumParams() < 2) {
-      return SprintfTarget::None;
-    }
-    ParmVarDecl *First = *Decl->param_begin();
-    QualType FirstType = First->getType().getCanonicalType();
-    if (FirstType->isPointerType()
-	&& FirstType->getPointeeType()->isCharType()) {
-      return SprintfTarget::CharPtr;
-    }
-    if (FirstType->isReferenceType()) {
-      QualType RefedType = FirstType->getPointeeType();
-      if (const RecordType *StructType = dyn_cast<RecordType>(RefedType)) {
-	RecordDecl *TypeDecl = StructType->getDecl();
-	std::string Name = TypeDecl->getQualifiedNameAsString();
-	if (Name == "MyString" ) {
-	  return SprintfTarget::MyString;
-	} else if (Name == "std::basic_string") {
-	  return SprintfTarget::StdString;
-	}
-      }
-    }
-    return SprintfTarget::Other;
-  }
-
-  ////////////////////////////////////////////////////////////////////
-  // strcpy/strcat
-
-  void ProcessStrcpy(CallExpr *Expr)
-  {
-    if (FunctionDecl *Decl = Expr->getDirectCallee()) {
-      std::string FunctionName = Decl->getNameAsString();
-      std::string ParameterName;
-      if (isStrcpyName(FunctionName)
-	  && parameterNameInArgument(Expr, ParameterName)) {
-	Report(Expr->getExprLoc(), "strcpy",
-	       FunctionName + '(' + ParameterName + ')');
-      }
-    }
-  }
-
-  static bool isStrcpyName(const std::string &Name) {
-    return Name == "strcpy" || Name == "strcat" || Name == "sprintf";
-  }
-
-  struct ParameterNameVisitor : RecursiveASTVisitor<ParameterNameVisitor> {
-    std::string &Name;
-    bool Parameter;
-
-    ParameterNameVisitor(std::string &name)
-      : Name(name), Parameter(false)
-    {
-    }
-
-    bool VisitDeclRefExpr(DeclRefExpr *Expr) {
-      if (!Parameter) {
-	if (ParmVarDecl *Parm = dyn_cast<ParmVarDecl>(Expr->getDecl())) {
-	  Parameter = true;
-	  Name = Parm->getNameAsString();
-	}
-      }
-      return true;
-    }
-
-    bool VisitUnaryDeref(UnaryOperator *) {
-      // If we copy into a dereferenced pointer, we likely have a
-      // false positive because the pointee might have been
-      // allocated by us.
-      return false;
-    }
-
-    bool VisitMemberExpr(MemberExpr *Expr) {
-      // -> dereference is also a pointer dereference.
-      return !Expr->isArrow();
-    }
-  };
-
-  static bool parameterNameInArgument(CallExpr *Expr, std::string &name) {
-    if (Expr->getNumArgs() < 2) {
-      return false;
-    }
-    ParameterNameVisitor Visitor(name);
-    Visitor.TraverseStmt(Expr->getArg(0));
-    return Visitor.Parameter;
-  }
-
-  ////////////////////////////////////////////////////////////////////
-  // MyString
-
-  void ProcessMyStringOperator(CXXOperatorCallExpr *Expr)
+  Action()
+    : Options(new CheckerOptions), Jobs(1)
   {
-    QualType Type;
-    switch (Expr->getOperator()) {
-    case OO_Subscript:
-      if (matchTypeAgainstMyString(Expr, Type)) {
-	std::string message("operator[] ");
-	if (!Type.isConstQualified()) {
-	  message += "non-";
-	}
-	message += "const";
-	Report(Expr->getExprLoc(), "MyString", message);
-      }
-      break;
-    case OO_PlusEqual:
-      if (matchTypeAgainstMyString(Expr, Type)) {
-	Type = Expr->getArg(1)->getType().getCanonicalType()
-	  .getUnqualifiedType();
-	std::string TypeName(Type.getAsString());
-	if (TypeName != "char"
-	    && TypeName != "const char *" 
-	    && TypeName != "class MyString") {
-	  Report(Expr->getExprLoc(), "MyString", "operator+= " + TypeName);
-	}
-      }
-      break;
-    default:
-      ;
-    }
   }
 
-  // Returns true if the unqualified type is class MyString, and
-  // and stores the potentially qualified type in the reference.
-  bool matchTypeAgainstMyString(CXXOperatorCallExpr *Expr, QualType &Type)
-  {
-    Type = Expr->getArg(0)->getType();
-    QualType UType = Type.getCanonicalType().getUnqualifiedType();
-    return UType.getAsString() == "class MyString";
+protected:
+  ASTConsumer *CreateASTConsumer(CompilerInstance &, llvm::StringRef) {
+    return new ConsumerFromVisitor
+      <CheckerVisitor<HTCONDOR_ANALYSIS_CHECKERS> >(FileDB, Options, Jobs);
   }
 
-  ////////////////////////////////////////////////////////////////////
-  // sizeof and pointers
-
-  void ProcessSizeofCallExpr(CallExpr *Call)
-  {
-    // indexed by argument position
-    typedef std::map<unsigned, const Expr *> ArgMap;
-    ArgMap SizeofArguments; 
-
-    // Find sizeof with pointer arguments.
-    // ??? This shoud generalize to sizeofs of non-array arguments
-    // ??? and we could check if the same expression is used
-    // ??? in a non-reference-taking context in the parameter list.
-    unsigned NumArgs = Call->getNumArgs();
-    for (unsigned i = 0; i < NumArgs; ++i) {
-      const Expr *ArgExpr = ExtractSizeofPointer(Call->getArg(i));
-      if (ArgExpr != NULL) {
-	SizeofArguments[i] = ArgExpr;
-      }
-    }
-    
-    // Check for exact matches with other arguments.
-    ArgMap::iterator end = SizeofArguments.end();
-    if (!SizeofArguments.empty()) {
-      for (unsigned i = 0; i < NumArgs; ++i) {
-	for (ArgMap::iterator p = SizeofArguments.begin(); p != end; ++p) {
-	  if (p->first == i) {
-	    continue;
-	  }
-	  if (EquivalentExpr(Call->getArg(i), p->second)) {
-	    std::ostringstream ostr;
-	    ostr << "pointer=" << i << ", sizeof=" << p->first;
-	    Report(Call->getArg(p->first)->getExprLoc(),
-		   "sizeof-pointer", ostr.str());
-	    return;
-	  }
-	}
-      }
-    }
-  }
+  bool ParseArgs(const CompilerInstance &CI,
+                 const std::vector<std::string>& args) {
 
-  // Recognizes sizeof(ptr) and sizeof(ptr)-expr.
-  const Expr *ExtractSizeofPointer(const Expr *E)
-  {
-    E = E->IgnoreParenCasts();
-    if (const UnaryExprOrTypeTraitExpr *SE = dyn_cast<UnaryExprOrTypeTraitExpr>(E)) {
-      if (SE->getKind() == UETT_SizeOf && !SE->isArgumentType()) {
-	E = SE->getArgumentExpr()->IgnoreParenCasts();
-	if (E->getType()->isPointerType()) {
-	  return E;
+    std::string DatabasePath;
+    for (std::vector<std::string>::const_iterator p = args.begin(),
+	   end = args.end(); p != end; ++p) {
+      if (*p == "help") {
+	PrintHelp(llvm::errs());
+      } else if (p->compare(0, 5, "jobs=") == 0) {
+	const char *Value = p->c_str() + 5;
+	char *End;
+	unsigned long N = strtoul(Value, &End, 10);
+	if (*Value == '\0' || *End != '\0' || N > 1024) {
+	  FatalError(CI.getDiagnostics(), "invalid argument: " + *p);
+	  return false;
 	}
-      }
-    } else if (const BinaryOperator *O = dyn_cast<BinaryOperator>(E)) {
-      if (O->getOpcode() == BO_Sub) {
-	E = ExtractSizeofPointer(O->getLHS());
-	if (E != NULL) {
-	  return E;
+	if (N == 0) {
+	  long CPUs = sysconf(_SC_NPROCESSORS_ONLN);
+	  N = CPUs > 0 ? CPUs : 1;
 	}
-      }
-    }
-    return NULL;
-  }
-
-  bool EquivalentExpr(const Expr *L, const Expr *R)
-  {
-    L = L->IgnoreParenCasts();
-    R = R->IgnoreParenCasts();
-    
-    if (const DeclRefExpr *LD = dyn_cast<DeclRefExpr>(L)) {
-      if (const DeclRefExpr *RD = dyn_cast<DeclRefExpr>(R)) {
-	return LD->getDecl() == RD->getDecl();
-      }
-      return false;
-    }
-    if (const UnaryOperator *LO = dyn_cast<UnaryOperator>(L)) {
-      if (const UnaryOperator *RO = dyn_cast<UnaryOperator>(R)) {
-	return LO->getOpcode() == RO->getOpcode()
-	  && EquivalentExpr(LO->getSubExpr(), RO->getSubExpr());
-      }
-      return false;
-    }
-    if (const BinaryOperator *LO = dyn_cast<BinaryOperator>(L)) {
-      if (const BinaryOperator *RO = dyn_cast<BinaryOperator>(R)) {
-	return LO->getOpcode() == RO->getOpcode()
-	  && EquivalentExpr(LO->getLHS(), RO->getLHS())
-	  && EquivalentExpr(LO->getRHS(), RO->getRHS());
-      }
-      return false;
-    }
-    return false;
-  }
-
-  ////////////////////////////////////////////////////////////////////
-  // Pointer arithmetic
-
-  // TODO: Catch simple subscripts which are statically within array
-  // bounds.
-
-  void PointerArithProcessUnaryOperator(UnaryOperator *Expr)
-  {
-    UnaryOperatorKind Kind = Expr->getOpcode();
-    const char *KindStr;
-    switch (Kind) {
-    case UO_PostInc:
-    case UO_PreInc:
-      KindStr = "inplace-add";
-      break;
-    case UO_PostDec:
-    case UO_PreDec:
-      KindStr = "inplace-sub";
-      break;
-    default:
-      KindStr = NULL;
-    }
-    if (KindStr != NULL && Expr->getType()->isPointerType()) {
-      Report(Expr->getExprLoc(), "pointer-arith", KindStr);
-    }
-  }
-
-  void PointerArithProcessBinaryOperator(BinaryOperator *Expr)
-  {
-    BinaryOperatorKind Kind = Expr->getOpcode();
-    const char *KindStr;
-    switch (Kind) {
-    case BO_Add:
-      KindStr = "add";
-      break;
-    case BO_Sub:
-      KindStr = "sub";
-      break;
-    case BO_AddAssign:
-      KindStr = "inplace-add";
-      break;
-    case BO_SubAssign:
-      KindStr = "inplace-sub";
-      break;
-    default:
-      KindStr = NULL;
-    }
-    if (KindStr != NULL) {
-      unsigned Pointers = 0;
-      if (Expr->getLHS()->getType()->isPointerType()
-	  || Expr->getLHS()->getType()->isArrayType()) {
-	++Pointers;
-      }
-      if (Expr->getRHS()->getType()->isPointerType()
-	  || Expr->getRHS()->getType()->isArrayType()) {
-	++Pointers;
-      }
-      switch (Pointers) {
-      case 1:
-	Report(Expr->getExprLoc(), "pointer-arith", KindStr);
-	break;
-      case 2:
-	Report(Expr->getExprLoc(), "pointer-arith", "diff");
-	break;
-      }
-    }
-  }
-
-  void PointerArithProcessSubscript(ArraySubscriptExpr *E)
-  {
-    Expr *Subscript = NULL;
-    if (E->getLHS()->getType()->isPointerType()
-	|| E->getLHS()->getType()->isArrayType()) {
-      Subscript = E->getRHS();
-    } else if (E->getRHS()->getType()->isPointerType()
-	       || E->getRHS()->getType()->isArrayType()) {
-      Subscript = E->getLHS();
-    }
-    
-    if (Subscript != NULL) {
-      llvm::APSInt I;
-      if (!(Subscript->EvaluateAsInt(I, Context) && I == 0)) {
-	Report(E->getExprLoc(), "pointer-arith", "subscript");
-      }
-    }
-  }
-
-  ////////////////////////////////////////////////////////////////////
-  // Array subscripts without bounds checks
-
-  void StandardLibraryProcessSubscript(CXXOperatorCallExpr *Expr)
-  {
-    if (Expr->getOperator() == OO_Subscript) {
-      QualType Type;
-      if (matchTypeAgainstVectorOrString(Expr, Type)) {
-	const char *message =
-	  Type.isConstQualified() ? "operator[] const" : "operator[]";
-	Report(Expr->getExprLoc(), message, Type.getAsString());
-      }
-    }
-  }
-
-  // Returns true if the unqualified type is an instance of the
-  // standard library templates vector or basic_string.
-  bool matchTypeAgainstVectorOrString(CXXOperatorCallExpr *Expr, QualType &Type)
-  {
-    Type = Expr->getArg(0)->getType();
-    QualType UType = Type.getCanonicalType().getUnqualifiedType();
-    if (const RecordType *RType = dyn_cast<RecordType>(UType.getTypePtr())) {
-      if (ClassTemplateSpecializationDecl *Decl =
-	  dyn_cast<ClassTemplateSpecializationDecl>(RType->getDecl())) {
-	const std::string Name
-	  (Decl->getSpecializedTemplate()->getQualifiedNameAsString());
-	return Name == "std::vector"
-	  || Name == "std::basic_string"
-	  || Name == "std::array";
-      }
-    }
-    return false;
-  }
-
-  //////////////////////////////////////////////////////////////////////
-  // alloca
-
-  void ProcessAlloca(CallExpr *E)
-  {
-    if (Expr *Callee = E->getCallee()->IgnoreParenCasts()) {
-      if (DeclRefExpr *Ref = dyn_cast<DeclRefExpr>(Callee)) {
-	if (FunctionDecl *FD = dyn_cast<FunctionDecl>(Ref->getDecl())) {
-	  unsigned BuiltinID = FD->getBuiltinID();
-	  if (BuiltinID) {
-	    Builtin::Context Ctx;
-	  }
-	  if (BuiltinID == Builtin::BI__builtin_alloca
-	      || BuiltinID == Builtin::BIalloca) {
-	    Report(E->getExprLoc(), "alloca", "x");
-	  }
+	Jobs = N;
+      } else if (p->compare(0, 8, "exclude=") == 0) {
+	std::string Prefix(*p, 8);
+	std::string Resolved;
+	if (ResolvePath(Prefix.c_str(), Resolved)) {
+	  Prefix = Resolved;
 	}
+	Options->Excluded.Add(Prefix);
+      } else if (p->compare(0, 10, "aggregate=") == 0) {
+	Options->Aggregated.insert(p->substr(10));
+      } else if (p->compare(0, 3, "db=") == 0) {
+	DatabasePath.assign(*p, 3, std::string::npos);
+      } else {
+	FatalError(CI.getDiagnostics(), "unknown argument: " + *p);
+	return false;
       }
     }
-  }
-
-  //////////////////////////////////////////////////////////////////////
-  // Static local variables
-
-  void ProcessStaticLocal(VarDecl *Decl)
-  {
-    if (Decl->isStaticLocal() && !Decl->getType().isConstQualified()) {
-      Report(Decl->getLocation(), "static-local", Decl->getNameAsString());
-    }
-  }
-
-
-  ////////////////////////////////////////////////////////////////////
-  // Helpers
-
-  void Report(SourceLocation Location, const char *Tool,
-	      const std::string &Message)
-  {
-    if (!Location.isValid()) {
-      FatalError(Context.getDiagnostics(),
-		 "attempt to report at an invalid source location");
-      return;
-    }
-
-    if (!FileDB->isOpen()) {
-      return;
-    }
-
-    // This obtains the source code location of the outmost macro call.
-    SourceManager &SM(Context.getSourceManager());
-    SourceLocation OuterLocation = Location;
-    while (OuterLocation.isMacroID()) {
-      OuterLocation = SM.getImmediateMacroCallerLoc(OuterLocation);
-    }
-    PresumedLoc PLoc = SM.getPresumedLoc(OuterLocation);
-    if (PLoc.isInvalid()) {
-      FatalError(Context.getDiagnostics(),
-		 "attempt to report at an invalid presumed location");
-      return;
-    }
-
-    const char *FileName = PLoc.getFilename();
-    unsigned Line = PLoc.getLine();
-    unsigned Column = PLoc.getColumn();
-    if (!FileDB->Report(FileName, Line, Column, Tool, Message)) {
-      FatalError(Context.getDiagnostics(), Location,
-		 "could not report: " + FileDB->ErrorMessage());
-      return;
-    }
-  }
-
-  static CXXMethodDecl *getMethodDecl(const CXXMemberCallExpr *Expr) {
-    if (const MemberExpr *MemExpr = 
-	dyn_cast<MemberExpr>(Expr->getCallee()->IgnoreParens())) {
-      return cast<CXXMethodDecl>(MemExpr->getMemberDecl());
-    }   
-    return 0;
-  }
-};
-
-class Action : public PluginASTAction {
-  std::tr1::shared_ptr<FileIdentificationDatabase> FileDB;
-
-protected:
-  ASTConsumer *CreateASTConsumer(CompilerInstance &, llvm::StringRef) {
-    return new ConsumerFromVisitor<OuterVisitor>(FileDB);
-  }
 
-  bool ParseArgs(const CompilerInstance &CI,
-                 const std::vector<std::string>& args) {
-
-    if (args.size() && args[0] == "help") {
-      PrintHelp(llvm::errs());
-    }
-    
-    std::tr1::shared_ptr<Database> DB(new Database);
-    if (!DB->Open()) {
-      FatalError(CI.getDiagnostics(), DB->ErrorMessage);
-      return false;
-    }
-    FileDB.reset(new FileIdentificationDatabase(DB));
+    // The database is opened when the results are committed.
+    FileDB.reset(new FileIdentificationDatabase(DatabasePath));
     return true;
   }
   void PrintHelp(llvm::raw_ostream& ros) {
-    ros << "Analyse HTCondor source code\n";
+    ros << "Analyse HTCondor source code\n"
+	<< "Arguments:\n"
+	<< "  jobs=N  traverse the translation unit with N threads "
+	<< "(0: one per processor)\n"
+	<< "  exclude=PREFIX  do not check declarations in files under "
+	<< "PREFIX\n"
+	<< "  aggregate=TOOL  report the findings of TOOL once per "
+	<< "function, with a count\n"
+	<< "  db=PATH  store the results in the database file PATH\n";
   }
 
 };
@@ -18,17 +18,29 @@
 
 #include "db-file.hpp"
 #include "db-report.hpp"
+#include "findings.hpp"
 #include "LineEditor.hpp"
+#include "file.hpp"
+#include "util.hpp"
 
+#include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 static bool
 Callback(bool verbose,
 	 const char *path, unsigned line, unsigned column,
-	 const char *tool, const char *message)
+	 const char *tool, const char *message, unsigned occurrences)
 {
-  printf("%s:%u:%u: (%s) %s\n", path, line, column, tool, message);
+  if (occurrences > 1) {
+    // An aggregated finding, counted for the whole function.
+    printf("%s:%u:%u: (%s) x%u %s\n",
+	   path, line, column, tool, occurrences, message);
+  } else {
+    printf("%s:%u:%u: (%s) %s\n", path, line, column, tool, message);
+  }
   if (verbose) {
     LineEditor le;
     le.Read(path);
@@ -39,39 +51,239 @@ Callback(bool verbose,
   return true;
 }
 
+static bool
+PrintChange(bool verbose, bool added,
+	    const char *path, unsigned line, unsigned column,
+	    const char *tool, const char *message, unsigned occurrences)
+{
+  putchar(added ? '+' : '-');
+  return Callback(verbose && added, path, line, column, tool, message,
+		  occurrences);
+}
+
+static bool
+PrintSummary(const char *key, unsigned long long count)
+{
+  printf("  %-40s %10llu\n", key, count);
+  return true;
+}
+
+// Prints the changes committed by other processes, until an error
+// occurs.  The current read transaction has seen the file versions
+// up to Baseline.
+static bool
+Watch(Database &DB, const ReportFilter &filter, bool verbose,
+      long long baseline)
+{
+  // Microseconds between polls of the data version, which changes
+  // when another connection commits.
+  const unsigned Interval = 250000;
+
+  Statement dataVersion;
+  if (!(DB.Execute("COMMIT")
+	&& dataVersion.Prepare(DB, "PRAGMA data_version"))) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return false;
+  }
+  using namespace std::tr1::placeholders;
+  long long version = -1;
+  while (1) {
+    fflush(stdout);
+    // The statement is reset immediately, so that it does not keep
+    // a read transaction open.
+    sqlite3_reset(dataVersion.Ptr);
+    if (sqlite3_step(dataVersion.Ptr) != SQLITE_ROW) {
+      DB.SetError(sqlite3_sql(dataVersion.Ptr));
+      fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+      return false;
+    }
+    long long current = sqlite3_column_int64(dataVersion.Ptr, 0);
+    sqlite3_reset(dataVersion.Ptr);
+    if (current == version) {
+      usleep(Interval);
+      continue;
+    }
+    version = current;
+
+    // Only the file versions added since the last pass are read.
+    long long last;
+    if (!DB.Execute("BEGIN")) {
+      fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+      return false;
+    }
+    if (!LastFileID(DB, last)) {
+      return false;
+    }
+    if (last != baseline
+	&& !ReportChangesSince(DB, baseline, filter,
+			       std::tr1::bind(PrintChange, verbose,
+					      _1, _2, _3, _4, _5, _6, _7))) {
+      return false;
+    }
+    if (!DB.Execute("COMMIT")) {
+      fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+      return false;
+    }
+    baseline = last;
+  }
+}
+
+static void
+Usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [-v] [-t TOOL]... [-p PREFIX | -g GLOB] "
+	  "[-s TIME] [-S SNAPSHOT] [-w] [DIRECTORY]\n"
+	  "       %s --summary [DIRECTORY]\n"
+	  "       %s [-v] [-t TOOL]... [-p PREFIX | -g GLOB] -f FILE\n",
+	  progname, progname, progname);
+}
+
+static const struct option LongOptions[] = {
+  {"verbose", no_argument, NULL, 'v'},
+  {"tool", required_argument, NULL, 't'},
+  {"path-prefix", required_argument, NULL, 'p'},
+  {"path-glob", required_argument, NULL, 'g'},
+  {"since", required_argument, NULL, 's'},
+  {"since-snapshot", required_argument, NULL, 'S'},
+  {"summary", no_argument, NULL, 'c'},
+  {"watch", no_argument, NULL, 'w'},
+  {"findings", required_argument, NULL, 'f'},
+  {NULL, 0, NULL, 0}
+};
+
 int
 main(int argc, char **argv)
 {
   bool verbose = false;
+  ReportFilter filter;
+  const char *snapshot = NULL;
+  bool summary = false;
+  bool watch = false;
+  const char *findings = NULL;
   int opt;
-  while ((opt = getopt(argc, argv, "v")) != -1) {
+  while ((opt = getopt_long(argc, argv, "vt:p:g:s:S:cwf:",
+			    LongOptions, NULL)) != -1) {
     switch (opt) {
     case 'v':
       verbose = true;
       break;
+    case 't':
+      filter.Tools.push_back(optarg);
+      break;
+    case 'p':
+      {
+	// Paths in the database are absolute.
+	std::string prefix;
+	if (optarg[0] != '/') {
+	  if (!ResolvePath(".", prefix)) {
+	    int code = errno;
+	    fprintf(stderr, "error: could not resolve current directory: %s\n",
+		    ErrorString(code).c_str());
+	    return 1;
+	  }
+	  prefix += '/';
+	}
+	prefix += optarg;
+	filter.SetPathPrefix(prefix);
+      }
+      break;
+    case 'g':
+      filter.PathGlob = optarg;
+      break;
+    case 's':
+      {
+	// Seconds since the epoch, as printed by "date +%s".
+	char *end;
+	errno = 0;
+	long long since = strtoll(optarg, &end, 10);
+	if (errno != 0 || *end != '\0' || end == optarg || since <= 0) {
+	  fprintf(stderr, "error: invalid time: %s\n", optarg);
+	  return 1;
+	}
+	filter.AnalyzedSince = since;
+      }
+      break;
+    case 'S':
+      snapshot = optarg;
+      break;
+    case 'c':
+      summary = true;
+      break;
+    case 'w':
+      watch = true;
+      break;
+    case 'f':
+      findings = optarg;
+      break;
     default:
-      fprintf(stderr, "usage: %s [-v] [DIRECTORY]\n", argv[0]);
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (summary && watch) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  using namespace std::tr1::placeholders;
+  if (findings != NULL) {
+    if (summary || watch || snapshot != NULL || filter.AnalyzedSince != 0
+	|| optind < argc) {
+      Usage(argv[0]);
       return 1;
     }
+    FindingsFile file;
+    if (!(file.Open(findings)
+	  && file.Report(filter, std::tr1::bind(Callback, verbose,
+						_1, _2, _3, _4, _5, _6)))) {
+      fprintf(stderr, "error: %s: %s\n", findings, file.ErrorMessage.c_str());
+      return 1;
+    }
+    return 0;
   }
 
   Database DB;
   if (optind < argc) {
-    if (!DB.Open(argv[optind])) {
+    if (!DB.OpenReadOnly(argv[optind])) {
       fprintf(stderr, "error: could not open database: %s\n",
 	      DB.ErrorMessage.c_str());
       return 1;
     }
   } else {
-    if (!DB.Open()) {
+    if (!DB.OpenReadOnly()) {
       fprintf(stderr, "error: could not open database: %s\n",
 	      DB.ErrorMessage.c_str());
       return 1;
     }
   }
 
-  using namespace std::tr1::placeholders;
-  bool ok = Report(DB, std::tr1::bind(Callback, verbose,
-				      _1, _2, _3, _4, _5));
+  // The queries read a single snapshot of the database, while the
+  // plugin may commit new results.
+  if (!DB.Execute("BEGIN")) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
+
+  bool ok;
+  if (summary) {
+    printf("Findings by tool:\n");
+    ok = ReportSummary(DB, SummaryKind::Tool, PrintSummary);
+    if (ok) {
+      printf("Findings by directory:\n");
+      ok = ReportSummary(DB, SummaryKind::Directory, PrintSummary);
+    }
+  } else if (snapshot != NULL) {
+    ok = ReportSinceSnapshot(DB, snapshot, filter,
+			     std::tr1::bind(PrintChange, verbose,
+					    _1, _2, _3, _4, _5, _6, _7));
+  } else {
+    ok = Report(DB, filter, std::tr1::bind(Callback, verbose,
+					   _1, _2, _3, _4, _5, _6));
+  }
+  if (ok && watch) {
+    long long baseline;
+    ok = LastFileID(DB, baseline)
+      && Watch(DB, filter, verbose, baseline);
+  }
   return ok ? 0 : 1;
 }
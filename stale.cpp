@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Lists translation units which have to be analyzed again because
+// files they include have changed since the analysis.  A file is
+// stale if it matches none of the versions recorded in the includes
+// table (by modification time and size, or by content hash).
+// Each stale file needs to be analyzed through one translation unit
+// only, so a small set of translation units is chosen from the
+// includes table, greedily: the translation unit which covers most
+// of the remaining stale files comes first.  The main files are
+// printed one per line.
+
+#include "db.hpp"
+#include "db-file.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <stdio.h>
+
+static void
+Usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [-v] [-d DATABASE]\n", progname);
+}
+
+static const struct option LongOptions[] = {
+  {"database", required_argument, NULL, 'd'},
+  {"verbose", no_argument, NULL, 'v'},
+  {NULL, 0, NULL, 0}
+};
+
+// Adds the files in the includes table which have changed since
+// the last analysis of every translation unit including them to
+// Stale.  Content hashes which were not in the cache are added to
+// NewHashes.
+static bool
+FindStaleFiles(Database &DB, bool verbose, std::vector<std::string> &Stale,
+	       ContentHashList &NewHashes)
+{
+  Statement Files, Version, Hashed;
+  if (!(Files.Prepare(DB, "SELECT DISTINCT file FROM includes ORDER BY file")
+	&& Version.Prepare(DB, "SELECT 1 FROM includes "
+			   "WHERE file = ? AND mtime = ? AND size = ?")
+	&& Hashed.Prepare(DB, "SELECT 1 FROM includes "
+			  "WHERE file = ? AND hash = ?"))) {
+    return false;
+  }
+  bool hashes = HasContentHashes(DB);
+  int ret;
+  while ((ret = sqlite3_step(Files.Ptr)) == SQLITE_ROW) {
+    const char *path = (const char *)sqlite3_column_text(Files.Ptr, 0);
+    FileIdentification FI(path);
+    if (!FI.Valid()) {
+      // Deleted files cannot be analyzed again.
+      if (verbose) {
+	fprintf(stderr, "%s: missing\n", path);
+      }
+      continue;
+    }
+    sqlite3_reset(Version.Ptr);
+    sqlite3_bind_text(Version.Ptr, 1, path, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(Version.Ptr, 2, FI.Mtime);
+    sqlite3_bind_int64(Version.Ptr, 3, FI.Size);
+    ret = sqlite3_step(Version.Ptr);
+    unsigned long long Hash;
+    bool Cached;
+    if (ret == SQLITE_DONE && hashes && ContentHash(DB, FI, Hash, Cached)) {
+      if (!Cached) {
+	NewHashes.push_back(std::make_pair(FI, Hash));
+      }
+      sqlite3_reset(Hashed.Ptr);
+      sqlite3_bind_text(Hashed.Ptr, 1, path, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int64(Hashed.Ptr, 2, Hash);
+      ret = sqlite3_step(Hashed.Ptr);
+    }
+    if (ret == SQLITE_DONE) {
+      if (verbose) {
+	fprintf(stderr, "%s: changed\n", path);
+      }
+      Stale.push_back(path);
+    } else if (ret != SQLITE_ROW) {
+      DB.SetError("file version");
+      return false;
+    }
+  }
+  if (ret != SQLITE_DONE) {
+    DB.SetError(sqlite3_sql(Files.Ptr));
+    return false;
+  }
+  return true;
+}
+
+// Chooses translation units from the includes table which cover the
+// stale files, and prints their main files.  Stale files without a
+// translation unit on disk are reported on standard error.
+static bool
+PrintTranslationUnits(Database &DB, const std::vector<std::string> &Stale)
+{
+  Statement Units;
+  if (!Units.Prepare(DB, "SELECT tu FROM includes WHERE file = ?")) {
+    return false;
+  }
+
+  // Indexes into Stale, by translation unit.
+  typedef std::map<std::string, std::vector<size_t> > CoverMap;
+  CoverMap Covers;
+  std::set<std::string> Missing;
+  std::vector<bool> Covered(Stale.size());
+  size_t Remaining = 0;
+  for (size_t i = 0; i < Stale.size(); ++i) {
+    sqlite3_reset(Units.Ptr);
+    sqlite3_bind_text(Units.Ptr, 1, Stale[i].data(), Stale[i].size(),
+		      SQLITE_TRANSIENT);
+    bool Found = false;
+    int ret;
+    while ((ret = sqlite3_step(Units.Ptr)) == SQLITE_ROW) {
+      std::string Unit((const char *)sqlite3_column_text(Units.Ptr, 0));
+      if (Missing.count(Unit) > 0) {
+	continue;
+      }
+      CoverMap::iterator p = Covers.find(Unit);
+      if (p == Covers.end()) {
+	if (!FileIdentification(Unit.c_str()).Valid()) {
+	  Missing.insert(Unit);
+	  continue;
+	}
+	p = Covers.insert(std::make_pair(Unit, std::vector<size_t>())).first;
+      }
+      p->second.push_back(i);
+      Found = true;
+    }
+    if (ret != SQLITE_DONE) {
+      DB.SetError(sqlite3_sql(Units.Ptr));
+      return false;
+    }
+    if (Found) {
+      ++Remaining;
+    } else {
+      Covered[i] = true;
+      fprintf(stderr, "%s: warning: no translation unit includes this file\n",
+	      Stale[i].c_str());
+    }
+  }
+
+  while (Remaining > 0) {
+    CoverMap::iterator Best = Covers.end();
+    size_t BestCount = 0;
+    for (CoverMap::iterator p = Covers.begin(), end = Covers.end();
+	 p != end; ++p) {
+      size_t Count = 0;
+      for (std::vector<size_t>::const_iterator q = p->second.begin(),
+	     qend = p->second.end(); q != qend; ++q) {
+	if (!Covered[*q]) {
+	  ++Count;
+	}
+      }
+      if (Count > BestCount) {
+	Best = p;
+	BestCount = Count;
+      }
+    }
+    for (std::vector<size_t>::const_iterator q = Best->second.begin(),
+	   qend = Best->second.end(); q != qend; ++q) {
+      Covered[*q] = true;
+    }
+    Remaining -= BestCount;
+    printf("%s\n", Best->first.c_str());
+    Covers.erase(Best);
+  }
+  return true;
+}
+
+int
+main(int argc, char **argv)
+{
+  const char *database = NULL;
+  bool verbose = false;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "d:v", LongOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'd':
+      database = optarg;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind != argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  Database DB;
+  if (!(database != NULL ? DB.OpenReadOnly(database) : DB.OpenReadOnly())) {
+    fprintf(stderr, "error: could not open database: %s\n",
+	    DB.ErrorMessage.c_str());
+    return 1;
+  }
+  std::vector<std::string> stale;
+  ContentHashList newHashes;
+  if (!(DB.Execute("BEGIN")
+	&& FindStaleFiles(DB, verbose, stale, newHashes)
+	&& PrintTranslationUnits(DB, stale))) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
+  // The database is opened read-only, so the hashes are stored
+  // through a separate connection.
+  if (!StoreContentHashes(DB, newHashes)) {
+    fprintf(stderr, "warning: could not cache content hashes: %s\n",
+	    DB.ErrorMessage.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Records the current state of the database under a name, for use
+// with "report --since-snapshot".  A snapshot only stores the highest
+// file ID, so recording it does not depend on the size of the
+// database.  The current summary counts are kept along with the
+// snapshot, to provide a history of the totals.
+
+#include "db.hpp"
+
+#include <stdio.h>
+#include <time.h>
+
+static TransactionResult::Enum
+Tag(Database &DB, const char *Name)
+{
+  Statement Insert;
+  TransactionResult::Enum tret = Insert.TxnPrepare
+    (DB, "INSERT INTO snapshots (name, created, last_file) "
+     "SELECT ?, ?, IFNULL(MAX(id), 0) FROM files");
+  if (tret != TransactionResult::COMMIT) {
+    return tret;
+  }
+  sqlite3_bind_text(Insert.Ptr, 1, Name, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(Insert.Ptr, 2, time(NULL));
+  int ret = sqlite3_step(Insert.Ptr);
+  if (ret == SQLITE_CONSTRAINT) {
+    DB.ErrorMessage = "snapshot already exists: ";
+    DB.ErrorMessage += Name;
+    return TransactionResult::ERROR;
+  }
+  if (ret != SQLITE_DONE) {
+    return DB.SetTransactionError(sqlite3_sql(Insert.Ptr));
+  }
+
+  Statement History;
+  tret = History.TxnPrepare
+    (DB, "INSERT INTO summary_history (snapshot, tool, directory, count) "
+     "SELECT ?, tool, directory, count FROM summary WHERE count != 0");
+  if (tret != TransactionResult::COMMIT) {
+    return tret;
+  }
+  sqlite3_bind_int64(History.Ptr, 1, sqlite3_last_insert_rowid(DB.Ptr));
+  if (sqlite3_step(History.Ptr) != SQLITE_DONE) {
+    return DB.SetTransactionError(sqlite3_sql(History.Ptr));
+  }
+  return TransactionResult::COMMIT;
+}
+
+int
+main(int argc, char **argv)
+{
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s NAME [DIRECTORY]\n", argv[0]);
+    return 1;
+  }
+
+  Database DB;
+  if (argc > 2) {
+    if (!DB.Open(argv[2])) {
+      fprintf(stderr, "error: could not open database: %s\n",
+	      DB.ErrorMessage.c_str());
+      return 1;
+    }
+  } else {
+    if (!DB.Open()) {
+      fprintf(stderr, "error: could not open database: %s\n",
+	      DB.ErrorMessage.c_str());
+      return 1;
+    }
+  }
+
+  if (DB.Transact(std::tr1::bind(Tag, std::tr1::ref(DB), argv[1]))
+      != TransactionResult::COMMIT) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
+  return 0;
+}
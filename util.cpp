@@ -91,3 +91,117 @@ ErrorString(int code)
   AppendErrorString(result, code);
   return result;
 }
+
+unsigned long long
+HashBytes(unsigned long long Hash, const void *Data, size_t Length)
+{
+  const unsigned char *p = static_cast<const unsigned char *>(Data);
+  const unsigned char *end = p + Length;
+  for (; p != end; ++p) {
+    Hash ^= *p;
+    Hash *= 1099511628211ULL;
+  }
+  return Hash;
+}
+
+unsigned long long
+HashString(unsigned long long Hash, const std::string &Str)
+{
+  return HashBytes(Hash, Str.c_str(), Str.size() + 1);
+}
+
+namespace {
+  const unsigned long long Prime1 = 11400714785074694791ULL;
+  const unsigned long long Prime2 = 14029467366897019727ULL;
+  const unsigned long long Prime3 = 1609587929392839161ULL;
+  const unsigned long long Prime4 = 9650029242287828579ULL;
+  const unsigned long long Prime5 = 2870177450012600261ULL;
+
+  inline unsigned long long
+  Rotate(unsigned long long Value, unsigned Bits)
+  {
+    return (Value << Bits) | (Value >> (64 - Bits));
+  }
+
+  // Little-endian loads.  GCC turns these into single instructions.
+  inline unsigned long long
+  Load64(const unsigned char *p)
+  {
+    return (unsigned long long)p[0] | ((unsigned long long)p[1] << 8)
+      | ((unsigned long long)p[2] << 16) | ((unsigned long long)p[3] << 24)
+      | ((unsigned long long)p[4] << 32) | ((unsigned long long)p[5] << 40)
+      | ((unsigned long long)p[6] << 48) | ((unsigned long long)p[7] << 56);
+  }
+
+  inline unsigned long long
+  Load32(const unsigned char *p)
+  {
+    return (unsigned long long)p[0] | ((unsigned long long)p[1] << 8)
+      | ((unsigned long long)p[2] << 16) | ((unsigned long long)p[3] << 24);
+  }
+
+  inline unsigned long long
+  Round(unsigned long long Acc, unsigned long long Input)
+  {
+    Acc += Input * Prime2;
+    return Rotate(Acc, 31) * Prime1;
+  }
+
+  inline unsigned long long
+  Merge(unsigned long long Acc, unsigned long long Lane)
+  {
+    Acc ^= Round(0, Lane);
+    return Acc * Prime1 + Prime4;
+  }
+}
+
+unsigned long long
+FastHash(const void *Data, size_t Length)
+{
+  const unsigned char *p = static_cast<const unsigned char *>(Data);
+  const unsigned char *end = p + Length;
+  unsigned long long Hash;
+  if (Length >= 32) {
+    unsigned long long v1 = Prime1 + Prime2;
+    unsigned long long v2 = Prime2;
+    unsigned long long v3 = 0;
+    unsigned long long v4 = -Prime1;
+    const unsigned char *limit = end - 32;
+    do {
+      v1 = Round(v1, Load64(p));
+      v2 = Round(v2, Load64(p + 8));
+      v3 = Round(v3, Load64(p + 16));
+      v4 = Round(v4, Load64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    Hash = Rotate(v1, 1) + Rotate(v2, 7) + Rotate(v3, 12) + Rotate(v4, 18);
+    Hash = Merge(Hash, v1);
+    Hash = Merge(Hash, v2);
+    Hash = Merge(Hash, v3);
+    Hash = Merge(Hash, v4);
+  } else {
+    Hash = Prime5;
+  }
+  Hash += Length;
+
+  for (; p + 8 <= end; p += 8) {
+    Hash ^= Round(0, Load64(p));
+    Hash = Rotate(Hash, 27) * Prime1 + Prime4;
+  }
+  if (p + 4 <= end) {
+    Hash ^= Load32(p) * Prime1;
+    Hash = Rotate(Hash, 23) * Prime2 + Prime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    Hash ^= *p * Prime5;
+    Hash = Rotate(Hash, 11) * Prime1;
+  }
+
+  Hash ^= Hash >> 33;
+  Hash *= Prime2;
+  Hash ^= Hash >> 29;
+  Hash *= Prime3;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
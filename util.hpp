@@ -36,6 +36,23 @@ void AppendErrorString(std::string &, int code);
 // Returns the error string for the code.
 std::string ErrorString(int code);
 
+// Initial value for HashBytes.
+const unsigned long long HashInitial = 14695981039346656037ULL;
+
+// Updates the 64-bit FNV-1a hash value with the bytes.
+unsigned long long HashBytes(unsigned long long Hash,
+			     const void *Data, size_t Length);
+
+// Updates the hash value with the string, including a terminator,
+// so that the concatenation of several strings is unambiguous.
+unsigned long long HashString(unsigned long long Hash,
+			      const std::string &);
+
+// Returns the XXH64 hash (seed 0) of the bytes.  It processes four
+// independent 64-bit lanes, so it is much faster than HashBytes on
+// large inputs, such as the contents of source files.
+unsigned long long FastHash(const void *Data, size_t Length);
+
 // Utility class to invoke free() on a pointer when the scope is left.
 class FreeOnExit {
   void *Ptr;
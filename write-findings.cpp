@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 The htcondor-analyzer contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Writes the findings which report would print to a findings file
+// (see findings.cpp).  "report --findings=FILE" reads such a file
+// instead of the database, which is much smaller and does not have
+// to be opened by SQLite.
+
+#include "db.hpp"
+#include "db-report.hpp"
+#include "file.hpp"
+#include "findings.hpp"
+#include "util.hpp"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void
+Usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [-v] [-d DATABASE] [-t TOOL]... "
+	  "[-p PREFIX | -g GLOB] [-s TIME] FILE\n", progname);
+}
+
+static const struct option LongOptions[] = {
+  {"database", required_argument, NULL, 'd'},
+  {"verbose", no_argument, NULL, 'v'},
+  {"tool", required_argument, NULL, 't'},
+  {"path-prefix", required_argument, NULL, 'p'},
+  {"path-glob", required_argument, NULL, 'g'},
+  {"since", required_argument, NULL, 's'},
+  {NULL, 0, NULL, 0}
+};
+
+int
+main(int argc, char **argv)
+{
+  const char *database = NULL;
+  bool verbose = false;
+  ReportFilter filter;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "d:vt:p:g:s:",
+			    LongOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'd':
+      database = optarg;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    case 't':
+      filter.Tools.push_back(optarg);
+      break;
+    case 'p':
+      {
+	// Paths in the database are absolute.
+	std::string prefix;
+	if (optarg[0] != '/') {
+	  if (!ResolvePath(".", prefix)) {
+	    int code = errno;
+	    fprintf(stderr, "error: could not resolve current directory: %s\n",
+		    ErrorString(code).c_str());
+	    return 1;
+	  }
+	  prefix += '/';
+	}
+	prefix += optarg;
+	filter.SetPathPrefix(prefix);
+      }
+      break;
+    case 'g':
+      filter.PathGlob = optarg;
+      break;
+    case 's':
+      {
+	char *end;
+	errno = 0;
+	long long since = strtoll(optarg, &end, 10);
+	if (errno != 0 || *end != '\0' || end == optarg || since <= 0) {
+	  fprintf(stderr, "error: invalid time: %s\n", optarg);
+	  return 1;
+	}
+	filter.AnalyzedSince = since;
+      }
+      break;
+    default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind + 1 != argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+  const char *path = argv[optind];
+
+  Database DB;
+  if (!(database != NULL ? DB.OpenReadOnly(database) : DB.OpenReadOnly())) {
+    fprintf(stderr, "error: could not open database: %s\n",
+	    DB.ErrorMessage.c_str());
+    return 1;
+  }
+  // The findings come from a single snapshot of the database.
+  if (!DB.Execute("BEGIN")) {
+    fprintf(stderr, "error: %s\n", DB.ErrorMessage.c_str());
+    return 1;
+  }
+
+  unsigned long long reports, skipped;
+  if (!WriteFindingsFile(DB, filter, path, reports, skipped)) {
+    fprintf(stderr, "error: %s: %s\n", path, DB.ErrorMessage.c_str());
+    return 1;
+  }
+  if (verbose) {
+    fprintf(stderr, "%s: %llu findings\n", path, reports);
+  }
+  // The other findings have been written, but as with report, the
+  // missing files make the result incomplete.
+  if (skipped > 0) {
+    fprintf(stderr, "error: %s: %llu files left out\n", path, skipped);
+    return 1;
+  }
+  return 0;
+}